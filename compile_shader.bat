@@ -1,6 +1,16 @@
-C:\VulkanSDK\1.3.283.0\Bin\glslc.exe shaders\base_vert_shader.vert -o shaders/base_vert_shader.vert.spv
-C:\VulkanSDK\1.3.283.0\Bin\glslc.exe shaders\base_frag_shader.frag -o shaders/base_frag_shader.frag.spv
+@echo off
+rem compiles every shader with glslc and validates it, a failure fails the build
+set SDK_BIN=C:\VulkanSDK\1.3.283.0\Bin
 
-C:\VulkanSDK\1.3.283.0\Bin\glslc.exe shaders\point_light.vert -o shaders/point_light.vert.spv
-C:\VulkanSDK\1.3.283.0\Bin\glslc.exe shaders\point_light.frag -o shaders/point_light.frag.spv
+call :compile shaders\base_vert_shader.vert || exit /b 1
+call :compile shaders\base_vert_shader_packed.vert || exit /b 1
+call :compile shaders\base_frag_shader.frag || exit /b 1
 
+call :compile shaders\point_light.vert || exit /b 1
+call :compile shaders\point_light.frag || exit /b 1
+exit /b 0
+
+:compile
+%SDK_BIN%\glslc.exe --target-env=vulkan1.2 %1 -o %1.spv || exit /b 1
+%SDK_BIN%\spirv-val.exe --target-env vulkan1.2 %1.spv || exit /b 1
+exit /b 0
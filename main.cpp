@@ -1,4 +1,5 @@
 #include "src/app.hpp"
+#include "src/lv_transform_batch.hpp"
 
 #include <stdexcept>
 #include <iostream>
@@ -26,6 +27,11 @@ int main() {
 
     //glfwTerminate();
 
+#ifdef LV_TRANSFORM_BATCH_SELF_TEST
+    if (!lv::LvTransformBatch::runSelfTest())
+        return EXIT_FAILURE;
+#endif
+
     try
     {
         lv::App vulkanApp{};
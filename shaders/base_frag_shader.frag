@@ -1,18 +1,15 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec3 fragColor;
 layout(location = 1) in vec3 fragWorldPos;
 layout(location = 2) in vec3 fragNormal;
 layout(location = 3) in vec2 fragUV;
+// the same for every instance of a draw
+layout(location = 4) flat in int fragTextureIndex;
 
 layout (location = 0) out vec4 outColor;
 
-layout(push_constant) uniform Push 
-{
-	mat4 modelMatrix;
-	mat4 normalMatrix;
-} push;
-
 struct PointLight
 {
 	vec4 position;
@@ -29,7 +26,8 @@ layout(set = 0, binding = 0) uniform GlobalUbo
 	int numLights;
 } ubo;
 
-layout(set = 1, binding = 0) uniform sampler2D texSampler;
+// every texture of the device's texture table, partially bound
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
 void main()
 {
@@ -65,7 +63,9 @@ void main()
 		specularColor += lightColor * blinnTerm;
 	}
 
-	outColor = texture(texSampler, fragUV);
+	outColor = fragTextureIndex < 0
+		? vec4(fragColor, 1.0)
+		: texture(textures[fragTextureIndex], fragUV);
 	
 	//outColor = vec4(diffuseColor * fragColor + specularColor * fragColor, 1.0f);
 }
\ No newline at end of file
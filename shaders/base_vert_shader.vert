@@ -5,10 +5,15 @@ layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec2 uv;
 
+// per instance, SimpleInstanceData
+layout(location = 4) in mat4 modelMatrix;
+layout(location = 8) in mat4 normalMatrix;
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragWorldPos;
 layout(location = 2) out vec3 fragNormal;
 layout(location = 3) out vec2 fragUV;
+layout(location = 4) flat out int fragTextureIndex;
 
 struct PointLight
 {
@@ -26,21 +31,15 @@ layout(set = 0, binding = 0) uniform GlobalUbo
 	int numLights;
 } ubo;
 
-layout(set = 1, binding = 0) uniform sampler2D texSampler;
-
-layout(push_constant) uniform Push 
-{
-	mat4 modelMatrix;
-	mat4 normalMatrix;
-} push;
-
 void main() {
-	vec4 worldPos = push.modelMatrix * vec4(position, 1.0);
+	vec4 worldPos = modelMatrix * vec4(position, 1.0);
 	
 	gl_Position = ubo.projection * (ubo.view * worldPos);
 
 	fragWorldPos = worldPos.xyz;
-	fragNormal = normalize(mat3(push.normalMatrix) * normal);
+	fragNormal = normalize(mat3(normalMatrix) * normal);
 	fragColor = color;
 	fragUV = uv;
+	// normalMatrix[3][3] is the texture index, negative if untextured
+	fragTextureIndex = int(normalMatrix[3][3]);
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#version 450
+
+// LvModel::PackedVertex, modelMatrix includes the
+// position dequantization
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 octNormal;
+layout(location = 3) in vec2 uv;
+
+// per instance, SimpleInstanceData
+layout(location = 4) in mat4 modelMatrix;
+layout(location = 8) in mat4 normalMatrix;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragWorldPos;
+layout(location = 2) out vec3 fragNormal;
+layout(location = 3) out vec2 fragUV;
+layout(location = 4) flat out int fragTextureIndex;
+
+struct PointLight
+{
+	vec4 position;
+	vec4 color; //w is for intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo
+{
+	mat4 projection;
+	mat4 view;
+	mat4 inverseView;
+	vec4 ambientLightColor;
+	PointLight pointLights[10]; // use specialisation constants of Vulkan
+	int numLights;
+} ubo;
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main() {
+	vec4 worldPos = modelMatrix * vec4(position.xyz, 1.0);
+	
+	gl_Position = ubo.projection * (ubo.view * worldPos);
+
+	fragWorldPos = worldPos.xyz;
+	fragNormal = normalize(mat3(normalMatrix) * decodeOctahedral(octNormal));
+	fragColor = color.rgb;
+	fragUV = uv;
+	// normalMatrix[3][3] is the texture index, negative if untextured
+	fragTextureIndex = int(normalMatrix[3][3]);
+}
\ No newline at end of file
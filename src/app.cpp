@@ -3,9 +3,12 @@
 #include "systems/simple_render_system.hpp"
 #include "systems/point_light_system.hpp"
 #include "input_controller.hpp"
+#include "lv_pixel_pool.hpp"
 
 #include <array>
 #include <chrono>
+#include <cmath>
+#include <iostream>
 
 namespace lv
 {
@@ -17,6 +20,7 @@ namespace lv
 				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 
 				LvSwapChain::MAX_FRAMES_IN_FLIGHT)
 			.build();
+		assetLoader.setTextureStreaming(true);
 		loadGameObjects();
 	}
 
@@ -72,31 +76,54 @@ namespace lv
 
 		LvCamera camera{};
 
-		auto viewerObject = LvGameObject::createGameObject();
-		viewerObject.transform.translation = glm::vec3(0.f, -0.5f, -5.5f);
+		TransformComponent viewerTransform{};
+		viewerTransform.translation = glm::vec3(0.f, -0.5f, -5.5f);
 		InputController cameraController{};
 
 		auto currentTime = std::chrono::high_resolution_clock::now();
 
+		constexpr uint32_t STATS_FRAME_COUNT = 256;
+		uint32_t statsFrame = 0;
+		float renderRecordTime = 0.f;
+
+		bool isSceneLoaded = false;
 		while (!lvWindow.shouldClose())
 		{
 			lvWindow.pollEvents();
 
+			assetLoader.update();
+			if (!isSceneLoaded && assetLoader.getPendingCount() == 0)
+			{
+				isSceneLoaded = true;
+				lvDevice.getMemoryAllocator().printStats();
+				assetRegistry.printStats();
+				LvPixelPool::printStats();
+			}
+
 			auto newTime = std::chrono::high_resolution_clock::now();
 			float frameTime =
 				std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
 			currentTime = newTime;
 
 			cameraController.updateInPlaneXZ(
-				lvWindow.getGLFWwindow(), frameTime, viewerObject);
+				lvWindow.getGLFWwindow(), frameTime, viewerTransform);
 			camera.setViewYXZ(
-				viewerObject.transform.translation,
-				viewerObject.transform.rotation);
+				viewerTransform.translation,
+				viewerTransform.rotation);
 
 			float aspect = lvRenderer.getAspectRatio();
 			camera.setPerspectiveProjection(
 				glm::radians(50.f), aspect, 0.5f, 100.f);
 
+			scene.updateTransforms();
+			textureStreamer.update(
+				scene,
+				camera,
+				static_cast<float>(lvRenderer.getSwapChainExtent().height));
+			const auto& streamingStats = textureStreamer.getStats();
+			if (streamingStats.uploadCount > 0 || streamingStats.evictionCount > 0)
+				textureStreamer.printStats();
+
 			if (auto commandBuffer = lvRenderer.beginFrame())
 			{
 				int frameIndex = lvRenderer.getFrameIndex();
@@ -108,7 +135,7 @@ namespace lv
 					commandBuffer,
 					camera,
 					globalDescriptorSets[frameIndex],
-					gameObjects
+					scene
 				};
 
 				GlobalUbo ubo{};
@@ -119,80 +146,76 @@ namespace lv
 				uboBuffers[frameIndex]->flush();
 
 				lvRenderer.beginSwapChainRenderPass(commandBuffer);
+				const auto recordStartTime = std::chrono::high_resolution_clock::now();
 				simpleRenderSystem.renderGameObjects(frameData);
+				renderRecordTime += std::chrono::duration<float, std::milli>(
+					std::chrono::high_resolution_clock::now() - recordStartTime).count();
 				pointLightSystem.render(frameData);
 				lvRenderer.endSwapChainRenderPass(commandBuffer);
 				lvRenderer.endFrame();
+
+				if (VASE_STRESS_SCENE && ++statsFrame == STATS_FRAME_COUNT)
+				{
+					std::cout << "simple render: "
+						<< simpleRenderSystem.getInstanceCount() << " objects in "
+						<< simpleRenderSystem.getDrawCount() << " draws, "
+						<< renderRecordTime / STATS_FRAME_COUNT
+						<< " ms recording per frame" << std::endl;
+					statsFrame = 0;
+					renderRecordTime = 0.f;
+				}
 			}
 		}
 
+		assetLoader.finish();
 		vkDeviceWaitIdle(lvDevice.getLogicalDevice());
 	}
 
 	void App::loadGameObjects()
 	{
-		std::shared_ptr<LvTexture> defaultTexture =
-			LvTexture::createTextureFromFile(
-				lvDevice,
-				"textures/default.png"
-			);
-
-		std::shared_ptr<LvTexture> statueTexture =
-			LvTexture::createTextureFromFile(
-				lvDevice,
-				"textures/statue.png"
-			);
-
-		std::shared_ptr<LvTexture> woodTexture =
-			LvTexture::createTextureFromFile(
-				lvDevice,
-				"textures/wood.png"
-			);
+		if (VASE_STRESS_SCENE)
+			loadStressScene();
 
 		/*
 		std::shared_ptr<LvModel> model1 = LvModel::createModelFromFile(
 			lvDevice, 
 			"models/flat_vase.obj"
 		);
-		auto gameObj1 = LvGameObject::createGameObject();
-		gameObj1.model = model1;
-		gameObj1.transform.translation = { -1.f, .5f, 0.f };
-		gameObj1.transform.scale = glm::vec3{3.5f};
-		gameObjects.emplace(
-			gameObj1.getId(), std::move(gameObj1));
+		TransformComponent transform1{};
+		transform1.translation = { -1.f, .5f, 0.f };
+		transform1.scale = glm::vec3{3.5f};
+		scene.getRenderables().add(
+			scene.createEntity(transform1), model1);
 
 		std::shared_ptr<LvModel> model2 = LvModel::createModelFromFile(
 			lvDevice,
 			"models/smooth_vase.obj"
 		);
-		auto gameObj2 = LvGameObject::createGameObject();
-		gameObj2.model = model2;
-		gameObj2.transform.translation = { 1.0f, .5f, 0.f };
-		gameObj2.transform.scale = glm::vec3{ 3.5f };
-		gameObjects.emplace(
-			gameObj2.getId(), std::move(gameObj2));
+		TransformComponent transform2{};
+		transform2.translation = { 1.0f, .5f, 0.f };
+		transform2.scale = glm::vec3{ 3.5f };
+		scene.getRenderables().add(
+			scene.createEntity(transform2), model2);
 
 		std::shared_ptr<LvModel> model3 = LvModel::createModelFromFile(
 			lvDevice,
 			"models/smooth_vase.obj"
 		);
-		auto gameObj3 = LvGameObject::createGameObject();
-		gameObj3.model = model3;
-		gameObj3.transform.translation = { 0.f, .5f, -1.5f };
-		gameObj3.transform.scale = { 3.f, 1.5f, 3.f };
-		gameObjects.emplace(
-			gameObj3.getId(), std::move(gameObj3));
+		TransformComponent transform3{};
+		transform3.translation = { 0.f, .5f, -1.5f };
+		transform3.scale = { 3.f, 1.5f, 3.f };
+		scene.getRenderables().add(
+			scene.createEntity(transform3), model3);
 
 		std::shared_ptr<LvModel> model4 = LvModel::createModelFromFile(
 			lvDevice,
 			"models/quad.obj"
 		);
-		auto floor = LvGameObject::createGameObject();
-		floor.model = model4;
-		floor.transform.translation = { 0.f, .5f, 0.f };
-		floor.transform.scale = { 3.f, 1.5f, 3.f };
-		gameObjects.emplace(
-			floor.getId(), std::move(floor));
+		TransformComponent floorTransform{};
+		floorTransform.translation = { 0.f, .5f, 0.f };
+		floorTransform.scale = { 3.f, 1.5f, 3.f };
+		scene.getRenderables().add(
+			scene.createEntity(floorTransform), model4);
 
 		std::vector<glm::vec3> lightColors{
 			{1.f, .1f, .1f},
@@ -204,38 +227,72 @@ namespace lv
 		};
 
 		for (int i = 0; i < lightColors.size(); i++) {
-			auto pointLight = LvGameObject::makePointLight(0.5f);
-			pointLight.color = lightColors[i];
+			auto pointLight = scene.createPointLight(0.5f, 0.1f, lightColors[i]);
 			auto rotateLight = glm::rotate(
 				glm::mat4(1.f),
 				(i * glm::two_pi<float>()) / lightColors.size(),
 				{ 0.f, -1.f, 0.f });
-			pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -0.5f, -1.f, 1.f));
-			gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+			scene.editTransform(pointLight).translation =
+				glm::vec3(rotateLight * glm::vec4(-1.f, -0.5f, -1.f, 1.f));
 		}
 		*/
 
-		std::shared_ptr<LvModel> roomModel = 
-			LvModel::createModelFromFile(
-				lvDevice,
-				"models/viking_room.obj"
-			);
-		std::shared_ptr<LvTexture> roomTexture = 
-			LvTexture::createTextureFromFile(
-				lvDevice,
-				"textures/viking_room.png"
-			);
-
-		auto room = LvGameObject::createGameObject();
-		room.model = roomModel;
-		room.texture = roomTexture;
-		room.transform.translation = { 0.f, 0.f, 0.f };
-		room.transform.scale = glm::vec3{ 2.f };
-		room.transform.rotation = {
+		// the room shows up once the loader delivers it, textured with
+		// the placeholder until its own texture is ready
+		TransformComponent roomTransform{};
+		roomTransform.translation = { 0.f, 0.f, 0.f };
+		roomTransform.scale = glm::vec3{ 2.f };
+		roomTransform.rotation = {
 			glm::half_pi<float>(),
 			glm::half_pi<float>(), 
 			0.f };
-		gameObjects.emplace(
-			room.getId(), std::move(room));
+		const auto roomId = scene.createEntity(roomTransform);
+		scene.getRenderables().add(
+			roomId, nullptr, assetLoader.getPlaceholderTexture());
+
+		assetRegistry.loadModel(
+			"models/viking_room.obj",
+			[this, roomId](std::shared_ptr<LvModel> model) {
+				if (auto* room = scene.getRenderables().find(roomId))
+					room->model = model;
+			});
+		assetRegistry.loadTexture(
+			"textures/viking_room.png",
+			[this, roomId](std::shared_ptr<LvTexture> texture) {
+				auto* room = scene.getRenderables().find(roomId);
+				if (texture && room)
+					room->texture = texture;
+			});
+	}
+
+	void App::loadStressScene()
+	{
+		// a square grid behind the room, every vase shares one model
+		const uint32_t side = static_cast<uint32_t>(
+			std::ceil(std::sqrt(static_cast<float>(STRESS_VASE_COUNT))));
+		std::vector<LvScene::id_t> vaseIds;
+		vaseIds.reserve(STRESS_VASE_COUNT);
+		for (uint32_t i = 0; i < STRESS_VASE_COUNT; i++)
+		{
+			TransformComponent transform{};
+			transform.translation = {
+				(static_cast<float>(i % side) - side * 0.5f) * 0.5f,
+				0.5f,
+				2.f + static_cast<float>(i / side) * 0.5f };
+			transform.scale = glm::vec3{ 1.f };
+			const auto vaseId = scene.createEntity(transform);
+			scene.getRenderables().add(vaseId);
+			vaseIds.push_back(vaseId);
+		}
+
+		assetRegistry.loadModel(
+			"models/smooth_vase.obj",
+			[this, vaseIds](std::shared_ptr<LvModel> model) {
+				for (const auto vaseId : vaseIds)
+				{
+					if (auto* vase = scene.getRenderables().find(vaseId))
+						vase->model = model;
+				}
+			});
 	}
 }
\ No newline at end of file
@@ -4,9 +4,12 @@
 #include "lv_device.hpp"
 #include "lv_pipeline.hpp"
 #include "lv_swapchain.hpp"
-#include "lv_game_object.hpp"
+#include "lv_scene.hpp"
 #include "lv_renderer.hpp"
 #include "lv_descriptor.hpp"
+#include "lv_asset_loader.hpp"
+#include "lv_asset_registry.hpp"
+#include "lv_texture_streamer.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -24,15 +27,23 @@ namespace lv
 	public:
 		static constexpr int WIDTH = 800;
 		static constexpr int HEIGHT = 600;
+		static constexpr VkDeviceSize TEXTURE_BUDGET = 256ull << 20;
+		// adds a grid of identical vases and prints the CPU time spent
+		// recording them
+		static constexpr bool VASE_STRESS_SCENE = false;
+		static constexpr uint32_t STRESS_VASE_COUNT = 10000;
 
 	private:
 		LvWindow lvWindow{ "The Vulkan", WIDTH, HEIGHT};
 		LvDevice lvDevice{lvWindow};
 		LvRenderer lvRenderer{ lvWindow, lvDevice };
+		LvAssetLoader assetLoader{ lvDevice };
+		LvAssetRegistry assetRegistry{ assetLoader };
+		LvTextureStreamer textureStreamer{ lvDevice, TEXTURE_BUDGET };
 
 		std::unique_ptr<LvDescriptorPool> globalDescriptorPool 
 			= nullptr;
-		LvGameObject::Map gameObjects;
+		LvScene scene;
 
 	public:
 		App();
@@ -42,5 +53,6 @@ namespace lv
 
 	private:
 		void loadGameObjects();
+		void loadStressScene();
 	};
 }
\ No newline at end of file
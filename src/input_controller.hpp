@@ -1,6 +1,6 @@
 #pragma once
 
-#include "lv_game_object.hpp"
+#include "lv_scene.hpp"
 #include "lv_window.hpp"
 
 #include <glm/gtc/constants.hpp>
@@ -27,7 +27,7 @@ namespace lv
 		// left, right, forward, backward moves will happen
 		// in XZ plane
 		void updateInPlaneXZ(
-			GLFWwindow* window, float dt, LvGameObject& gameObject);
+			GLFWwindow* window, float dt, TransformComponent& transform);
 
 		InputMappings keyMap{};
 		float moveSpeed{ 3.f };
@@ -0,0 +1,209 @@
+#include "lv_asset_loader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+namespace lv
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	static float millisecondsSince(Clock::time_point startTime)
+	{
+		return std::chrono::duration<float, std::chrono::milliseconds::period>(
+			Clock::now() - startTime).count();
+	}
+
+	LvAssetLoader::LvAssetLoader(LvDevice& device, uint32_t threadCount)
+		: device{device}
+	{
+		placeholderTexture = LvTexture::createTextureFromFile(
+			device, PLACEHOLDER_TEXTURE);
+		workers = std::make_unique<LvThreadPool>(threadCount);
+	}
+
+	LvAssetLoader::~LvAssetLoader()
+	{
+		// queued decodes still run, their results are dropped unless
+		// they were already recorded into a batch
+		workers.reset();
+		inFlightBatches.clear();
+	}
+
+	uint32_t LvAssetLoader::defaultThreadCount()
+	{
+		// leave a core to the main thread
+		return std::max(LvThreadPool::defaultThreadCount(), 2u) - 1;
+	}
+
+	void LvAssetLoader::loadModel(
+		const std::string& filepath,
+		ModelCallback onLoaded,
+		LvModel::VertexFormat vertexFormat)
+	{
+		pendingCount += 1;
+		const auto startTime = Clock::now();
+		auto onFailed = [onLoaded]() { onLoaded(nullptr); };
+
+		workers->enqueue([this, filepath, onLoaded, onFailed, vertexFormat, startTime]() {
+			auto fileData = std::make_shared<LvModel::FileData>();
+			try
+			{
+				// the loader's workers already load models in parallel
+				LvModel::loadFile(filepath, vertexFormat, 1, *fileData);
+			}
+			catch (const std::exception& e)
+			{
+				pushError(filepath, e.what(), onFailed);
+				return;
+			}
+
+			pushReady([this, filepath, onLoaded, fileData, startTime](LvUploadBatch& batch) {
+				std::shared_ptr<LvModel> model = LvModel::createModel(device, *fileData, &batch);
+				model->printLoadInfo(filepath, fileData->isCached, millisecondsSince(startTime));
+				return [model, onLoaded]() { onLoaded(model); };
+			}, onFailed);
+		});
+	}
+
+	void LvAssetLoader::loadTexture(
+		const std::string& filepath,
+		TextureCallback onLoaded)
+	{
+		pendingCount += 1;
+		const auto startTime = Clock::now();
+		auto onFailed = [onLoaded]() { onLoaded(nullptr); };
+
+		const bool isStreamed = isTextureStreamingEnabled;
+		workers->enqueue([this, filepath, onLoaded, onFailed, startTime, isStreamed]() {
+			// pixels are released with the last reference to the builder
+			std::shared_ptr<LvTexture::Builder> builder(
+				new LvTexture::Builder{},
+				[](LvTexture::Builder* builder) {
+					builder->unloadTexture();
+					delete builder;
+				});
+			const auto decodeStartTime = Clock::now();
+			try
+			{
+				LvTexture::loadBuilder(device, filepath, *builder);
+				// keeps the CPU fallback off the main thread, streamed
+				// textures upload every level from the builder
+				if (!builder->isCached
+					&& (isStreamed || !device.isLinearBlitSupported(LvTexture::FORMAT)))
+					builder->buildMipChain();
+			}
+			catch (const std::exception& e)
+			{
+				pushError(filepath, e.what(), onFailed);
+				return;
+			}
+
+			const float decodeTime = millisecondsSince(decodeStartTime);
+
+			pushReady([this, filepath, onLoaded, builder, startTime, isStreamed, decodeTime](LvUploadBatch& batch) {
+				std::shared_ptr<LvTexture> texture;
+				if (isStreamed)
+				{
+					// starts at the tail, the streamer adds detail on demand
+					const uint32_t tailMip = LvTexture::computeTailMip(
+						static_cast<uint32_t>(builder->texWidth),
+						static_cast<uint32_t>(builder->texHeight),
+						builder->getLevelCount());
+					texture = std::make_shared<LvTexture>(device, builder, tailMip, &batch);
+				}
+				else
+				{
+					texture = std::make_shared<LvTexture>(device, *builder, &batch);
+				}
+				std::cout << "texture " << filepath
+					<< (builder->isCached ? " (cached)" : "")
+					<< (isStreamed ? " (streamed)" : "")
+					<< " decoded in " << decodeTime
+					<< " ms, loaded in " << millisecondsSince(startTime) << " ms" << std::endl;
+				return [texture, onLoaded]() { onLoaded(texture); };
+			}, onFailed);
+		});
+	}
+
+	void LvAssetLoader::pushReady(UploadStep step, std::function<void()> onFailed)
+	{
+		std::lock_guard<std::mutex> lock(readyMutex);
+		readyUploads.push_back({ std::move(step), std::move(onFailed) });
+	}
+
+	void LvAssetLoader::pushError(
+		const std::string& filepath,
+		const std::string& message,
+		std::function<void()> onFailed)
+	{
+		// reported from update() like every other result
+		pushReady([filepath, message, onFailed](LvUploadBatch&) {
+			return [filepath, message, onFailed]() {
+				std::cerr << "asset loader: failed to load " << filepath
+					<< ": " << message << std::endl;
+				onFailed();
+			};
+		}, onFailed);
+	}
+
+	void LvAssetLoader::update()
+	{
+		std::vector<ReadyUpload> uploads;
+		{
+			std::lock_guard<std::mutex> lock(readyMutex);
+			uploads.swap(readyUploads);
+		}
+
+		if (!uploads.empty())
+		{
+			InFlightBatch inFlight{};
+			inFlight.batch = std::make_unique<LvUploadBatch>(device);
+			for (auto& upload : uploads)
+			{
+				try
+				{
+					inFlight.completions.push_back(upload.record(*inFlight.batch));
+				}
+				catch (const std::exception& e)
+				{
+					// models and textures stage everything before their
+					// first command, a failed one left nothing in the batch
+					std::cerr << "asset loader: upload failed: " << e.what() << std::endl;
+					inFlight.completions.push_back(upload.onFailed);
+				}
+			}
+			inFlight.batch->submit();
+			inFlightBatches.push_back(std::move(inFlight));
+		}
+
+		// batches complete in submission order
+		while (!inFlightBatches.empty() && inFlightBatches.front().batch->isComplete())
+		{
+			InFlightBatch inFlight = std::move(inFlightBatches.front());
+			inFlightBatches.pop_front();
+
+			for (auto& completion : inFlight.completions)
+			{
+				if (completion)
+					completion();
+				pendingCount -= 1;
+			}
+		}
+	}
+
+	void LvAssetLoader::finish()
+	{
+		while (pendingCount.load() > 0)
+		{
+			update();
+
+			if (!inFlightBatches.empty())
+				inFlightBatches.front().batch->wait();
+			else if (pendingCount.load() > 0)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
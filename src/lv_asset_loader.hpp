@@ -0,0 +1,101 @@
+#pragma once
+
+#include "lv_device.hpp"
+#include "lv_model.hpp"
+#include "lv_texture.hpp"
+#include "lv_thread_pool.hpp"
+#include "lv_upload_batch.hpp"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lv
+{
+	// Loads models and textures in the background. File I/O, OBJ parsing
+	// and image decoding run on worker threads, update() on the main
+	// thread uploads whatever has been decoded in one batch and hands the
+	// resources to their callbacks once that batch has completed.
+	// Callbacks always run on the thread calling update(), with nullptr
+	// if the asset failed to load.
+	class LvAssetLoader
+	{
+	public:
+		static constexpr const char* PLACEHOLDER_TEXTURE = "textures/default.png";
+
+		using ModelCallback = std::function<void(std::shared_ptr<LvModel>)>;
+		using TextureCallback = std::function<void(std::shared_ptr<LvTexture>)>;
+
+	private:
+		// records the device side of a decoded asset and returns what to
+		// run once the batch it was recorded into has completed
+		using UploadStep = std::function<std::function<void()>(LvUploadBatch&)>;
+
+		struct ReadyUpload
+		{
+			UploadStep record;
+			// run in place of the completion if recording throws
+			std::function<void()> onFailed;
+		};
+
+		struct InFlightBatch
+		{
+			std::unique_ptr<LvUploadBatch> batch;
+			std::vector<std::function<void()>> completions;
+		};
+
+		LvDevice& device;
+		std::shared_ptr<LvTexture> placeholderTexture;
+
+		std::vector<ReadyUpload> readyUploads;
+		std::mutex readyMutex;
+		std::deque<InFlightBatch> inFlightBatches;
+		std::atomic<uint32_t> pendingCount{ 0 };
+		std::atomic<bool> isTextureStreamingEnabled{ false };
+
+		std::unique_ptr<LvThreadPool> workers;
+
+	public:
+		LvAssetLoader(
+			LvDevice& device,
+			uint32_t threadCount = defaultThreadCount());
+		~LvAssetLoader();
+
+		LvAssetLoader(const LvAssetLoader&) = delete;
+		LvAssetLoader& operator=(const LvAssetLoader&) = delete;
+
+		void loadModel(
+			const std::string& filepath,
+			ModelCallback onLoaded,
+			LvModel::VertexFormat vertexFormat = LvModel::VertexFormat::Standard);
+		void loadTexture(
+			const std::string& filepath,
+			TextureCallback onLoaded);
+
+		// call once per frame, never blocks on the GPU
+		void update();
+		// blocks until every requested asset has been delivered
+		void finish();
+
+		// textures loaded afterwards only upload their mip tail and keep
+		// their source for LvTextureStreamer
+		void setTextureStreaming(bool enabled) { isTextureStreamingEnabled = enabled; }
+
+		// loaded synchronously, for objects whose texture is not ready yet
+		std::shared_ptr<LvTexture> getPlaceholderTexture() const { return placeholderTexture; }
+		uint32_t getPendingCount() const { return pendingCount.load(); }
+
+		static uint32_t defaultThreadCount();
+
+	private:
+		void pushReady(UploadStep step, std::function<void()> onFailed);
+		void pushError(
+			const std::string& filepath,
+			const std::string& message,
+			std::function<void()> onFailed);
+	};
+}
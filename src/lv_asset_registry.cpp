@@ -0,0 +1,151 @@
+#include "lv_asset_registry.hpp"
+
+#include <filesystem>
+#include <iostream>
+
+namespace lv
+{
+	template<typename T>
+	static long useCount(
+		const std::unordered_map<std::string, T>& entries,
+		const std::string& key)
+	{
+		auto it = entries.find(key);
+		return it != entries.end() ? it->second.resource.use_count() : 0;
+	}
+
+	template<typename T>
+	static size_t residentCount(const std::unordered_map<std::string, T>& entries)
+	{
+		size_t count = 0;
+		for (const auto& kv : entries)
+		{
+			if (!kv.second.resource.expired())
+				count++;
+		}
+		return count;
+	}
+
+	LvAssetRegistry::LvAssetRegistry(LvAssetLoader& loader)
+		: loader{loader}
+	{
+		// the placeholder is resident for the loader's lifetime anyway
+		textures[makeKey(LvAssetLoader::PLACEHOLDER_TEXTURE, 0)].resource =
+			loader.getPlaceholderTexture();
+	}
+
+	std::string LvAssetRegistry::makeKey(const std::string& filepath, uint32_t options)
+	{
+		// "models/../models/a.obj" and "models/a.obj" are the same asset
+		std::error_code ec;
+		auto path = std::filesystem::weakly_canonical(filepath, ec);
+		const std::string canonicalPath = ec ? filepath : path.generic_string();
+		return canonicalPath + "#" + std::to_string(options);
+	}
+
+	void LvAssetRegistry::loadModel(
+		const std::string& filepath,
+		ModelCallback onLoaded,
+		LvModel::VertexFormat vertexFormat)
+	{
+		request(
+			models,
+			makeKey(filepath, static_cast<uint32_t>(vertexFormat)),
+			std::move(onLoaded),
+			[this, filepath, vertexFormat](ModelCallback onDone) {
+				loader.loadModel(filepath, std::move(onDone), vertexFormat);
+			});
+	}
+
+	void LvAssetRegistry::loadTexture(
+		const std::string& filepath,
+		TextureCallback onLoaded)
+	{
+		request(
+			textures,
+			makeKey(filepath, 0),
+			std::move(onLoaded),
+			[this, filepath](TextureCallback onDone) {
+				loader.loadTexture(filepath, std::move(onDone));
+			});
+	}
+
+	template<typename T, typename Load>
+	void LvAssetRegistry::request(
+		std::unordered_map<std::string, Entry<T>>& entries,
+		const std::string& key,
+		std::function<void(std::shared_ptr<T>)> onLoaded,
+		Load load)
+	{
+		stats.requestCount++;
+
+		Entry<T>& entry = entries[key];
+		if (auto resource = entry.resource.lock())
+		{
+			stats.hitCount++;
+			onLoaded(resource);
+			return;
+		}
+
+		entry.waiting.push_back(std::move(onLoaded));
+		if (entry.waiting.size() > 1)
+		{
+			stats.joinCount++;
+			return;
+		}
+
+		stats.loadCount++;
+		load([&entries, key](std::shared_ptr<T> resource) {
+			auto it = entries.find(key);
+			auto waiting = std::move(it->second.waiting);
+			it->second.waiting.clear();
+
+			// failed loads are retried by the next request
+			if (resource)
+				it->second.resource = resource;
+			else
+				entries.erase(it);
+
+			for (auto& callback : waiting)
+				callback(resource);
+		});
+	}
+
+	long LvAssetRegistry::getModelUseCount(
+		const std::string& filepath,
+		LvModel::VertexFormat vertexFormat) const
+	{
+		return useCount(models, makeKey(filepath, static_cast<uint32_t>(vertexFormat)));
+	}
+
+	long LvAssetRegistry::getTextureUseCount(const std::string& filepath) const
+	{
+		return useCount(textures, makeKey(filepath, 0));
+	}
+
+	void LvAssetRegistry::removeUnused()
+	{
+		auto removeFrom = [](auto& entries) {
+			for (auto it = entries.begin(); it != entries.end();)
+			{
+				if (it->second.resource.expired() && it->second.waiting.empty())
+					it = entries.erase(it);
+				else
+					++it;
+			}
+		};
+		removeFrom(models);
+		removeFrom(textures);
+	}
+
+	void LvAssetRegistry::printStats() const
+	{
+		std::cout << "asset registry: "
+			<< residentCount(models) << " models, "
+			<< residentCount(textures) << " textures resident, "
+			<< stats.requestCount << " requests, "
+			<< stats.hitCount << " hits, "
+			<< stats.joinCount << " joined, "
+			<< stats.loadCount << " loads" << std::endl;
+	}
+}
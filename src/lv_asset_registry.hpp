@@ -0,0 +1,91 @@
+#pragma once
+
+#include "lv_asset_loader.hpp"
+#include "lv_model.hpp"
+#include "lv_texture.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lv
+{
+	// Hands out shared handles to models and textures, keyed by canonical
+	// path plus load options, so every asset is read, decoded and uploaded
+	// once no matter how many objects use it. Entries only hold weak
+	// references: an asset is unloaded with its last handle and loaded
+	// again on the next request. Requests for an asset that is still
+	// loading join the load in flight.
+	//
+	// Main thread only, like the loader callbacks it is built on.
+	class LvAssetRegistry
+	{
+	public:
+		using ModelCallback = LvAssetLoader::ModelCallback;
+		using TextureCallback = LvAssetLoader::TextureCallback;
+
+		struct Stats
+		{
+			uint32_t requestCount = 0;
+			// served by a resident asset
+			uint32_t hitCount = 0;
+			// attached to a load in flight
+			uint32_t joinCount = 0;
+			uint32_t loadCount = 0;
+		};
+
+	private:
+		template<typename T>
+		struct Entry
+		{
+			std::weak_ptr<T> resource;
+			// callbacks of every request made while loading
+			std::vector<std::function<void(std::shared_ptr<T>)>> waiting;
+		};
+
+		LvAssetLoader& loader;
+		std::unordered_map<std::string, Entry<LvModel>> models;
+		std::unordered_map<std::string, Entry<LvTexture>> textures;
+		Stats stats{};
+
+	public:
+		LvAssetRegistry(LvAssetLoader& loader);
+
+		LvAssetRegistry(const LvAssetRegistry&) = delete;
+		LvAssetRegistry& operator=(const LvAssetRegistry&) = delete;
+
+		// the callback runs right away if the asset is resident,
+		// otherwise from LvAssetLoader::update()
+		void loadModel(
+			const std::string& filepath,
+			ModelCallback onLoaded,
+			LvModel::VertexFormat vertexFormat = LvModel::VertexFormat::Standard);
+		void loadTexture(
+			const std::string& filepath,
+			TextureCallback onLoaded);
+
+		// number of live handles, 0 if the asset is not resident
+		long getModelUseCount(
+			const std::string& filepath,
+			LvModel::VertexFormat vertexFormat = LvModel::VertexFormat::Standard) const;
+		long getTextureUseCount(const std::string& filepath) const;
+
+		// forgets entries whose asset has been released
+		void removeUnused();
+
+		const Stats& getStats() const { return stats; }
+		void printStats() const;
+
+		static std::string makeKey(const std::string& filepath, uint32_t options);
+
+	private:
+		template<typename T, typename Load>
+		void request(
+			std::unordered_map<std::string, Entry<T>>& entries,
+			const std::string& key,
+			std::function<void(std::shared_ptr<T>)> onLoaded,
+			Load load);
+	};
+}
@@ -0,0 +1,558 @@
+#include "lv_block_encoder.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace lv
+{
+	static constexpr uint32_t BLOCK_TEXELS = 16;
+
+	// BC7 4 bit index interpolation weights, out of 64
+	static constexpr int BC7_WEIGHTS[16] = {
+		0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Mean and dominant direction of the block's colors over the first
+	// channelCount channels, found by power iteration on the covariance.
+	static void fitPrincipalAxis(
+		const uint8_t* block,
+		uint32_t channelCount,
+		float* mean,
+		float* axis)
+	{
+		for (uint32_t c = 0; c < channelCount; c++)
+		{
+			float sum = 0.f;
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+				sum += block[i * 4 + c];
+			mean[c] = sum / BLOCK_TEXELS;
+		}
+
+		float covariance[4][4]{};
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		{
+			float d[4];
+			for (uint32_t c = 0; c < channelCount; c++)
+				d[c] = block[i * 4 + c] - mean[c];
+			for (uint32_t r = 0; r < channelCount; r++)
+				for (uint32_t c = 0; c < channelCount; c++)
+					covariance[r][c] += d[r] * d[c];
+		}
+
+		for (uint32_t c = 0; c < channelCount; c++)
+			axis[c] = 1.f;
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4]{};
+			for (uint32_t r = 0; r < channelCount; r++)
+				for (uint32_t c = 0; c < channelCount; c++)
+					next[r] += covariance[r][c] * axis[c];
+
+			float length = 0.f;
+			for (uint32_t c = 0; c < channelCount; c++)
+				length = std::max(length, std::abs(next[c]));
+			// flat block, any direction will do
+			if (length < 1e-6f)
+				return;
+			for (uint32_t c = 0; c < channelCount; c++)
+				axis[c] = next[c] / length;
+		}
+	}
+
+	// the block's extremes along its principal axis
+	static void fitEndpoints(
+		const uint8_t* block,
+		uint32_t channelCount,
+		float* low,
+		float* high)
+	{
+		float mean[4];
+		float axis[4];
+		fitPrincipalAxis(block, channelCount, mean, axis);
+
+		float axisLength = 0.f;
+		for (uint32_t c = 0; c < channelCount; c++)
+			axisLength += axis[c] * axis[c];
+
+		float minT = 0.f;
+		float maxT = 0.f;
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		{
+			float t = 0.f;
+			for (uint32_t c = 0; c < channelCount; c++)
+				t += (block[i * 4 + c] - mean[c]) * axis[c];
+			t /= axisLength;
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		for (uint32_t c = 0; c < channelCount; c++)
+		{
+			low[c] = std::clamp(mean[c] + minT * axis[c], 0.f, 255.f);
+			high[c] = std::clamp(mean[c] + maxT * axis[c], 0.f, 255.f);
+		}
+	}
+
+	static uint16_t packRgb565(const float* color)
+	{
+		uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.f / 255.f));
+		uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.f / 255.f));
+		uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.f / 255.f));
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	static void unpackRgb565(uint16_t packed, int* color)
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	static void writeLittleEndian(uint8_t* output, uint64_t value, uint32_t byteCount)
+	{
+		for (uint32_t i = 0; i < byteCount; i++)
+			output[i] = static_cast<uint8_t>(value >> (i * 8));
+	}
+
+	static uint64_t readLittleEndian(const uint8_t* input, uint32_t byteCount)
+	{
+		uint64_t value = 0;
+		for (uint32_t i = 0; i < byteCount; i++)
+			value |= static_cast<uint64_t>(input[i]) << (i * 8);
+		return value;
+	}
+
+	// 128 bit block written / read from the least significant bit up
+	class BlockBits
+	{
+	private:
+		uint8_t* bytes;
+		uint32_t position = 0;
+
+	public:
+		BlockBits(uint8_t* bytes) : bytes{bytes} {}
+
+		void write(uint32_t value, uint32_t bitCount)
+		{
+			for (uint32_t i = 0; i < bitCount; i++, position++)
+			{
+				if (value & (1u << i))
+					bytes[position / 8] |= static_cast<uint8_t>(1u << (position % 8));
+			}
+		}
+
+		uint32_t read(uint32_t bitCount)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < bitCount; i++, position++)
+			{
+				if (bytes[position / 8] & (1u << (position % 8)))
+					value |= 1u << i;
+			}
+			return value;
+		}
+	};
+
+	uint32_t LvBlockEncoder::getBlockSize(Format format)
+	{
+		return format == Format::BC1 ? 8 : 16;
+	}
+
+	size_t LvBlockEncoder::getEncodedSize(Format format, uint32_t width, uint32_t height)
+	{
+		const size_t blocksX = (width + BLOCK_DIM - 1) / BLOCK_DIM;
+		const size_t blocksY = (height + BLOCK_DIM - 1) / BLOCK_DIM;
+		return blocksX * blocksY * getBlockSize(format);
+	}
+
+	void LvBlockEncoder::encodeBlock(Format format, const uint8_t* block, uint8_t* output)
+	{
+		switch (format)
+		{
+		case Format::BC1:
+			encodeBC1(block, output);
+			break;
+		case Format::BC3:
+			encodeBC4(block, 3, output);
+			encodeBC1(block, output + 8);
+			break;
+		case Format::BC7:
+			encodeBC7Mode6(block, output);
+			break;
+		}
+	}
+
+	void LvBlockEncoder::decodeBlock(Format format, const uint8_t* input, uint8_t* block)
+	{
+		switch (format)
+		{
+		case Format::BC1:
+			decodeBC1(input, block, false);
+			break;
+		case Format::BC3:
+			decodeBC1(input + 8, block, true);
+			decodeBC4(input, 3, block);
+			break;
+		case Format::BC7:
+			decodeBC7(input, block);
+			break;
+		}
+	}
+
+	void LvBlockEncoder::encodeBC1(const uint8_t* block, uint8_t* output)
+	{
+		float low[3];
+		float high[3];
+		fitEndpoints(block, 3, low, high);
+
+		uint16_t color0 = packRgb565(high);
+		uint16_t color1 = packRgb565(low);
+		// color0 > color1 selects the 4 color mode in BC1
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		int palette[4][3];
+		unpackRgb565(color0, palette[0]);
+		unpackRgb565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+		{
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			{
+				uint32_t bestIndex = 0;
+				int bestError = INT32_MAX;
+				for (uint32_t p = 0; p < 4; p++)
+				{
+					int error = 0;
+					for (int c = 0; c < 3; c++)
+					{
+						int d = block[i * 4 + c] - palette[p][c];
+						error += d * d;
+					}
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+				indices |= bestIndex << (i * 2);
+			}
+		}
+
+		writeLittleEndian(output, color0, 2);
+		writeLittleEndian(output + 2, color1, 2);
+		writeLittleEndian(output + 4, indices, 4);
+	}
+
+	void LvBlockEncoder::encodeBC4(const uint8_t* block, uint32_t channel, uint8_t* output)
+	{
+		int minValue = 255;
+		int maxValue = 0;
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		{
+			minValue = std::min<int>(minValue, block[i * 4 + channel]);
+			maxValue = std::max<int>(maxValue, block[i * 4 + channel]);
+		}
+
+		// value0 > value1 selects 6 interpolated values
+		int palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (int p = 1; p < 7; p++)
+			palette[p + 1] = ((7 - p) * maxValue + p * minValue) / 7;
+
+		uint64_t indices = 0;
+		if (maxValue != minValue)
+		{
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			{
+				uint64_t bestIndex = 0;
+				int bestError = INT32_MAX;
+				for (uint32_t p = 0; p < 8; p++)
+				{
+					int error = std::abs(block[i * 4 + channel] - palette[p]);
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+				indices |= bestIndex << (i * 3);
+			}
+		}
+
+		output[0] = static_cast<uint8_t>(maxValue);
+		output[1] = static_cast<uint8_t>(minValue);
+		writeLittleEndian(output + 2, indices, 6);
+	}
+
+	void LvBlockEncoder::encodeBC7Mode6(const uint8_t* block, uint8_t* output)
+	{
+		float low[4];
+		float high[4];
+		fitEndpoints(block, 4, low, high);
+
+		// 7 bit endpoints plus a p-bit shared by the channels of each
+		// endpoint, pick the p-bit that lands closer
+		uint32_t quantized[2][4];
+		uint32_t pBits[2];
+		const float* endpoints[2] = { low, high };
+		for (int e = 0; e < 2; e++)
+		{
+			float bestError = INFINITY;
+			for (uint32_t p = 0; p < 2; p++)
+			{
+				uint32_t q[4];
+				float error = 0.f;
+				for (int c = 0; c < 4; c++)
+				{
+					float value = endpoints[e][c];
+					q[c] = static_cast<uint32_t>(std::clamp<long>(
+						std::lround((value - p) / 2.f), 0, 127));
+					float d = value - static_cast<float>((q[c] << 1) | p);
+					error += d * d;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					pBits[e] = p;
+					std::copy(q, q + 4, quantized[e]);
+				}
+			}
+		}
+
+		int palette[16][4];
+		for (int c = 0; c < 4; c++)
+		{
+			int e0 = static_cast<int>((quantized[0][c] << 1) | pBits[0]);
+			int e1 = static_cast<int>((quantized[1][c] << 1) | pBits[1]);
+			for (int p = 0; p < 16; p++)
+				palette[p][c] = (e0 * (64 - BC7_WEIGHTS[p]) + e1 * BC7_WEIGHTS[p] + 32) >> 6;
+		}
+
+		uint32_t indices[BLOCK_TEXELS];
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		{
+			uint32_t bestIndex = 0;
+			int bestError = INT32_MAX;
+			for (uint32_t p = 0; p < 16; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					int d = block[i * 4 + c] - palette[p][c];
+					error += d * d;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+			indices[i] = bestIndex;
+		}
+
+		// the first index is stored without its top bit, which therefore
+		// has to be 0
+		if (indices[0] & 8)
+		{
+			std::swap(quantized[0], quantized[1]);
+			std::swap(pBits[0], pBits[1]);
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+				indices[i] = 15 - indices[i];
+		}
+
+		memset(output, 0, 16);
+		BlockBits bits{ output };
+		bits.write(1u << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			bits.write(quantized[0][c], 7);
+			bits.write(quantized[1][c], 7);
+		}
+		bits.write(pBits[0], 1);
+		bits.write(pBits[1], 1);
+		bits.write(indices[0], 3);
+		for (uint32_t i = 1; i < BLOCK_TEXELS; i++)
+			bits.write(indices[i], 4);
+	}
+
+	void LvBlockEncoder::decodeBC1(const uint8_t* input, uint8_t* block, bool isOpaque)
+	{
+		const uint16_t color0 = static_cast<uint16_t>(readLittleEndian(input, 2));
+		const uint16_t color1 = static_cast<uint16_t>(readLittleEndian(input + 2, 2));
+		const uint32_t indices = static_cast<uint32_t>(readLittleEndian(input + 4, 4));
+
+		int palette[4][4];
+		unpackRgb565(color0, palette[0]);
+		unpackRgb565(color1, palette[1]);
+		palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+		for (int c = 0; c < 3; c++)
+		{
+			if (isOpaque || color0 > color1)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		if (!isOpaque && color0 <= color1)
+			palette[3][3] = 0;
+
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		{
+			const uint32_t index = (indices >> (i * 2)) & 3;
+			for (int c = 0; c < 4; c++)
+				block[i * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+		}
+	}
+
+	void LvBlockEncoder::decodeBC4(const uint8_t* input, uint32_t channel, uint8_t* block)
+	{
+		const int value0 = input[0];
+		const int value1 = input[1];
+		const uint64_t indices = readLittleEndian(input + 2, 6);
+
+		int palette[8];
+		palette[0] = value0;
+		palette[1] = value1;
+		if (value0 > value1)
+		{
+			for (int p = 1; p < 7; p++)
+				palette[p + 1] = ((7 - p) * value0 + p * value1) / 7;
+		}
+		else
+		{
+			for (int p = 1; p < 5; p++)
+				palette[p + 1] = ((5 - p) * value0 + p * value1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			block[i * 4 + channel] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 7]);
+	}
+
+	void LvBlockEncoder::decodeBC7(const uint8_t* input, uint8_t* block)
+	{
+		uint8_t bytes[16];
+		memcpy(bytes, input, 16);
+		BlockBits bits{ bytes };
+
+		// only mode 6 is written by this encoder
+		if (bits.read(7) != (1u << 6))
+		{
+			memset(block, 0, BLOCK_TEXELS * 4);
+			return;
+		}
+
+		uint32_t endpoints[2][4];
+		for (int c = 0; c < 4; c++)
+		{
+			endpoints[0][c] = bits.read(7) << 1;
+			endpoints[1][c] = bits.read(7) << 1;
+		}
+		const uint32_t p0 = bits.read(1);
+		const uint32_t p1 = bits.read(1);
+		for (int c = 0; c < 4; c++)
+		{
+			endpoints[0][c] |= p0;
+			endpoints[1][c] |= p1;
+		}
+
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		{
+			const int weight = BC7_WEIGHTS[bits.read(i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; c++)
+			{
+				block[i * 4 + c] = static_cast<uint8_t>(
+					(endpoints[0][c] * (64 - weight) + endpoints[1][c] * weight + 32) >> 6);
+			}
+		}
+	}
+
+	void LvBlockEncoder::encodeImage(
+		Format format,
+		const uint8_t* pixels,
+		uint32_t width,
+		uint32_t height,
+		uint8_t* output)
+	{
+		const uint32_t blockSize = getBlockSize(format);
+		const uint32_t blocksX = (width + BLOCK_DIM - 1) / BLOCK_DIM;
+		const uint32_t blocksY = (height + BLOCK_DIM - 1) / BLOCK_DIM;
+
+		uint8_t block[BLOCK_TEXELS * 4];
+		for (uint32_t by = 0; by < blocksY; by++)
+		{
+			for (uint32_t bx = 0; bx < blocksX; bx++)
+			{
+				for (uint32_t y = 0; y < BLOCK_DIM; y++)
+				{
+					const uint32_t sy = std::min(by * BLOCK_DIM + y, height - 1);
+					for (uint32_t x = 0; x < BLOCK_DIM; x++)
+					{
+						const uint32_t sx = std::min(bx * BLOCK_DIM + x, width - 1);
+						memcpy(
+							block + (y * BLOCK_DIM + x) * 4,
+							pixels + (static_cast<size_t>(sy) * width + sx) * 4,
+							4);
+					}
+				}
+
+				encodeBlock(
+					format,
+					block,
+					output + (static_cast<size_t>(by) * blocksX + bx) * blockSize);
+			}
+		}
+	}
+
+	void LvBlockEncoder::decodeImage(
+		Format format,
+		const uint8_t* input,
+		uint32_t width,
+		uint32_t height,
+		uint8_t* pixels)
+	{
+		const uint32_t blockSize = getBlockSize(format);
+		const uint32_t blocksX = (width + BLOCK_DIM - 1) / BLOCK_DIM;
+		const uint32_t blocksY = (height + BLOCK_DIM - 1) / BLOCK_DIM;
+
+		uint8_t block[BLOCK_TEXELS * 4];
+		for (uint32_t by = 0; by < blocksY; by++)
+		{
+			for (uint32_t bx = 0; bx < blocksX; bx++)
+			{
+				decodeBlock(
+					format,
+					input + (static_cast<size_t>(by) * blocksX + bx) * blockSize,
+					block);
+
+				for (uint32_t y = 0; y < BLOCK_DIM && by * BLOCK_DIM + y < height; y++)
+				{
+					const uint32_t x0 = bx * BLOCK_DIM;
+					const uint32_t count = std::min(BLOCK_DIM, width - x0);
+					memcpy(
+						pixels + (static_cast<size_t>(by * BLOCK_DIM + y) * width + x0) * 4,
+						block + y * BLOCK_DIM * 4,
+						count * 4);
+				}
+			}
+		}
+	}
+}
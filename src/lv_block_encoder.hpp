@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lv
+{
+	// CPU encoder for the BCn block formats sampled by desktop GPUs. Works
+	// on tightly packed RGBA8 and needs no device, so it runs on build
+	// machines and in tests as well as at first load.
+	//
+	// BC1 and BC3 use a principal axis fit, BC7 only writes mode 6 (one
+	// RGBA subset, 4 bit indices), which is the usual choice for a fast
+	// encoder. The decoders cover what the encoder writes.
+	class LvBlockEncoder
+	{
+	public:
+		enum class Format : uint32_t
+		{
+			BC1, // RGB, 4 bpp, alpha is dropped
+			BC3, // RGBA, 8 bpp
+			BC7  // RGBA, 8 bpp, best quality
+		};
+
+		static constexpr uint32_t BLOCK_DIM = 4;
+
+		static uint32_t getBlockSize(Format format);
+		static size_t getEncodedSize(Format format, uint32_t width, uint32_t height);
+
+		// block is 4x4 RGBA8 texels in row order
+		static void encodeBlock(Format format, const uint8_t* block, uint8_t* output);
+		static void decodeBlock(Format format, const uint8_t* input, uint8_t* block);
+
+		// edge blocks of images that are not a multiple of 4 repeat the
+		// last row / column
+		static void encodeImage(
+			Format format,
+			const uint8_t* pixels,
+			uint32_t width,
+			uint32_t height,
+			uint8_t* output);
+		static void decodeImage(
+			Format format,
+			const uint8_t* input,
+			uint32_t width,
+			uint32_t height,
+			uint8_t* pixels);
+
+	private:
+		static void encodeBC1(const uint8_t* block, uint8_t* output);
+		static void encodeBC4(const uint8_t* block, uint32_t channel, uint8_t* output);
+		static void encodeBC7Mode6(const uint8_t* block, uint8_t* output);
+
+		static void decodeBC1(const uint8_t* input, uint8_t* block, bool isOpaque);
+		static void decodeBC4(const uint8_t* input, uint32_t channel, uint8_t* block);
+		static void decodeBC7(const uint8_t* input, uint8_t* block);
+	};
+}
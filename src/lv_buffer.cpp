@@ -10,7 +10,8 @@ namespace lv
 		uint32_t instanceCount,
 		VkBufferUsageFlags usageFlags,
 		VkMemoryPropertyFlags memoryPropertyFlags,
-		VkDeviceSize minOffsetAlignment)
+		VkDeviceSize minOffsetAlignment,
+		LvMemoryAllocator::Strategy strategy)
 		: device{ device },
 		instanceSize{ instanceSize },
 		instanceCount{ instanceCount },
@@ -20,12 +21,14 @@ namespace lv
 		alignmentSize = getAlignment(
 			instanceSize, minOffsetAlignment);
 		bufferSize = alignmentSize * instanceCount;
+
 		device.createBuffer(
 			bufferSize,
 			usageFlags,
 			memoryPropertyFlags,
 			buffer,
-			bufferMemory);
+			allocation,
+			strategy);
 	}
 
 	LvBuffer::~LvBuffer()
@@ -33,7 +36,7 @@ namespace lv
 		auto lDevice = device.getLogicalDevice();
 		unmap();
 		vkDestroyBuffer(lDevice, buffer, nullptr);
-		vkFreeMemory(lDevice, bufferMemory, nullptr);
+		device.getMemoryAllocator().free(allocation);
 	}
 
 	VkDeviceSize LvBuffer::getAlignment(
@@ -50,38 +53,22 @@ namespace lv
 
 	VkResult LvBuffer::map(VkDeviceSize size, VkDeviceSize offset)
 	{
-		assert(buffer && bufferMemory && "map not allowed before buffer creation");
-
-		if (size == VK_WHOLE_SIZE)
-		{
-			return vkMapMemory(
-				device.getLogicalDevice(),
-				bufferMemory,
-				0,
-				size,
-				0,
-				&mapped
-			);
-		}
-		return vkMapMemory(
-			device.getLogicalDevice(),
-			bufferMemory,
-			offset,
-			bufferSize,
-			0,
-			&mapped
-		);
+		assert(buffer && allocation.memory && "map not allowed before buffer creation");
+
+		// host visible memory is mapped by the allocator for as long as
+		// the buffer exists
+		if (allocation.mapped == nullptr)
+			return VK_ERROR_MEMORY_MAP_FAILED;
+		if (size != VK_WHOLE_SIZE && offset + size > bufferSize)
+			return VK_ERROR_MEMORY_MAP_FAILED;
 
+		mapped = static_cast<char*>(allocation.mapped) + offset;
+		return VK_SUCCESS;
 	}
 
 	void LvBuffer::unmap()
 	{
-		if (mapped)
-		{
-			vkUnmapMemory(
-				device.getLogicalDevice(), bufferMemory);
-			mapped = nullptr;
-		}
+		mapped = nullptr;
 	}
 
 	void LvBuffer::writeToBuffer(
@@ -99,13 +86,7 @@ namespace lv
 
 	VkResult LvBuffer::flush(VkDeviceSize size, VkDeviceSize offset)
 	{
-		VkMappedMemoryRange mappedRange = {};
-		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = bufferMemory;
-		mappedRange.offset = offset;
-		mappedRange.size = size;
-		return vkFlushMappedMemoryRanges(
-			device.getLogicalDevice(), 1, &mappedRange);
+		return device.getMemoryAllocator().flush(allocation, size, offset);
 	}
 
 	VkDescriptorBufferInfo LvBuffer::descriptorInfo(
@@ -121,13 +102,7 @@ namespace lv
 
 	VkResult LvBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset)
 	{
-		VkMappedMemoryRange mappedRange = {};
-		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = bufferMemory;
-		mappedRange.offset = offset;
-		mappedRange.size = size;
-		return vkInvalidateMappedMemoryRanges(
-			device.getLogicalDevice(), 1, &mappedRange);
+		return device.getMemoryAllocator().invalidate(allocation, size, offset);
 	}
 
 	void LvBuffer::writeToIndex(void* data, int index)
@@ -12,7 +12,7 @@ namespace lv
 		LvDevice& device;
 		void* mapped = nullptr;
 		VkBuffer buffer = VK_NULL_HANDLE;
-		VkDeviceMemory bufferMemory = VK_NULL_HANDLE;
+		LvMemoryAllocator::Allocation allocation{};
 
 		VkDeviceSize bufferSize;
 		uint32_t instanceCount;
@@ -32,7 +32,9 @@ namespace lv
 			uint32_t instanceCount,
 			VkBufferUsageFlags usageFlags,
 			VkMemoryPropertyFlags memoryPropertyFlags,
-			VkDeviceSize minOffsetAlignment = 1);
+			VkDeviceSize minOffsetAlignment = 1,
+			LvMemoryAllocator::Strategy strategy =
+				LvMemoryAllocator::Strategy::FreeList);
 		~LvBuffer();
 
 		LvBuffer(const LvBuffer&) = delete;
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace lv
+{
+	// Sparse set of components of one type. The components and the ids
+	// owning them sit in two parallel dense arrays, so systems walk them
+	// linearly, while the sparse array maps an entity id to its dense
+	// slot for lookups. Removal moves the last component into the hole,
+	// which invalidates references and reorders the dense arrays.
+	template <typename T>
+	class LvComponentPool
+	{
+	public:
+		using id_t = uint32_t;
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	private:
+		std::vector<uint32_t> sparse;
+		std::vector<id_t> ids;
+		std::vector<T> components;
+
+	public:
+		template <typename... Args>
+		T& add(id_t id, Args&&... args)
+		{
+			assert(!has(id) && "entity already has this component");
+			if (id >= sparse.size())
+				sparse.resize(id + 1, INVALID_INDEX);
+
+			sparse[id] = static_cast<uint32_t>(components.size());
+			ids.push_back(id);
+			components.push_back(T{ std::forward<Args>(args)... });
+			return components.back();
+		}
+
+		void remove(id_t id)
+		{
+			if (!has(id))
+				return;
+
+			const uint32_t index = sparse[id];
+			const uint32_t last = static_cast<uint32_t>(components.size() - 1);
+			if (index != last)
+			{
+				components[index] = std::move(components[last]);
+				ids[index] = ids[last];
+				sparse[ids[index]] = index;
+			}
+			components.pop_back();
+			ids.pop_back();
+			sparse[id] = INVALID_INDEX;
+		}
+
+		void clear()
+		{
+			sparse.clear();
+			ids.clear();
+			components.clear();
+		}
+
+		bool has(id_t id) const
+		{
+			return id < sparse.size() && sparse[id] != INVALID_INDEX;
+		}
+
+		T& get(id_t id)
+		{
+			assert(has(id) && "entity does not have this component");
+			return components[sparse[id]];
+		}
+
+		const T& get(id_t id) const
+		{
+			assert(has(id) && "entity does not have this component");
+			return components[sparse[id]];
+		}
+
+		// nullptr if the entity does not have the component
+		T* find(id_t id)
+		{
+			return has(id) ? &components[sparse[id]] : nullptr;
+		}
+
+		// slot in the dense arrays
+		uint32_t indexOf(id_t id) const
+		{
+			assert(has(id) && "entity does not have this component");
+			return sparse[id];
+		}
+
+		// order lists every id of the pool once, the dense arrays are
+		// rearranged to follow it
+		void reorder(const std::vector<id_t>& order)
+		{
+			assert(order.size() == ids.size() && "order must list every id once");
+
+			std::vector<T> sorted;
+			sorted.reserve(components.size());
+			for (const id_t id : order)
+				sorted.push_back(std::move(components[sparse[id]]));
+
+			components = std::move(sorted);
+			ids = order;
+			for (uint32_t i = 0; i < static_cast<uint32_t>(ids.size()); i++)
+				sparse[ids[i]] = i;
+		}
+
+		size_t size() const { return components.size(); }
+		bool empty() const { return components.empty(); }
+
+		// dense order, index i belongs to getIds()[i]
+		std::vector<T>& getComponents() { return components; }
+		const std::vector<T>& getComponents() const { return components; }
+		const std::vector<id_t>& getIds() const { return ids; }
+
+		typename std::vector<T>::iterator begin() { return components.begin(); }
+		typename std::vector<T>::iterator end() { return components.end(); }
+		typename std::vector<T>::const_iterator begin() const { return components.begin(); }
+		typename std::vector<T>::const_iterator end() const { return components.end(); }
+	};
+}
@@ -11,7 +11,8 @@ namespace lv
 		uint32_t bindingIndex,
 		VkDescriptorType descriptorType,
 		VkShaderStageFlags stageFlags,
-		uint32_t count)
+		uint32_t count,
+		VkDescriptorBindingFlags flags)
 	{
 		assert(bindings.count(bindingIndex) == 0 && 
 			"binding already exists at the given index");
@@ -23,6 +24,16 @@ namespace lv
 		layoutBinding.stageFlags = stageFlags;
 		
 		bindings[bindingIndex] = layoutBinding;
+		if (flags != 0)
+			bindingFlags[bindingIndex] = flags;
+		return *this;
+	}
+
+	LvDescriptorSetLayout::Builder&
+		LvDescriptorSetLayout::Builder::setLayoutFlags(
+		VkDescriptorSetLayoutCreateFlags flags)
+	{
+		layoutFlags = flags;
 		return *this;
 	}
 
@@ -31,27 +42,48 @@ namespace lv
 	{
 		return std::make_unique<LvDescriptorSetLayout>(
 			device,
-			bindings);
+			bindings,
+			bindingFlags,
+			layoutFlags);
 	}
 
 	// Descriptor set layout
 
 	LvDescriptorSetLayout::LvDescriptorSetLayout(
 		LvDevice& lvDevice,
-		std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>bindings) 
+		std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>bindings,
+		const std::unordered_map<uint32_t, VkDescriptorBindingFlags>&
+			bindingFlags,
+		VkDescriptorSetLayoutCreateFlags layoutFlags) 
 		: device{lvDevice}, bindings{bindings}
 	{
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+		std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
 		for (auto &kv : bindings) {
 			setLayoutBindings.push_back(kv.second);
+
+			auto flags = bindingFlags.find(kv.first);
+			setLayoutBindingFlags.push_back(
+				flags != bindingFlags.end() ? flags->second : 0);
 		}
 
+		// flags array has to match pBindings one to one
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+		bindingFlagsInfo.sType =
+			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		bindingFlagsInfo.bindingCount =
+			static_cast<uint32_t>(setLayoutBindingFlags.size());
+		bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
 		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
 		descriptorSetLayoutInfo.sType =
 			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 		descriptorSetLayoutInfo.bindingCount = 
 			static_cast<uint32_t>(setLayoutBindings.size());
 		descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
+		descriptorSetLayoutInfo.flags = layoutFlags;
+		if (!bindingFlags.empty())
+			descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
 
 		if (vkCreateDescriptorSetLayout(
 			device.getLogicalDevice(),
@@ -203,20 +235,22 @@ namespace lv
 	LvDescriptorWriter& LvDescriptorWriter::writeImage(
 		uint32_t binding,
 		VkDescriptorType type,
-		VkDescriptorImageInfo* imageInfo) {
+		VkDescriptorImageInfo* imageInfo,
+		uint32_t arrayElement) {
 		assert(setLayout.bindings.count(binding) == 1 &&
 			"Layout does not contain specified binding");
 
 		auto& bindingDescription = setLayout.bindings[binding];
 
 		assert(
-			bindingDescription.descriptorCount == 1 &&
-			"Binding single descriptor info, but binding expects multiple");
+			arrayElement < bindingDescription.descriptorCount &&
+			"Array element is out of the binding range");
 
 		VkWriteDescriptorSet write{};
 		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		write.descriptorType = bindingDescription.descriptorType;
 		write.dstBinding = binding;
+		write.dstArrayElement = arrayElement;
 		write.pImageInfo = imageInfo;
 		write.descriptorCount = 1;
 		write.descriptorType = type;
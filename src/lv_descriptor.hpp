@@ -19,18 +19,26 @@ namespace lv
                 uint32_t bindingIndex,
                 VkDescriptorType descriptorType,
                 VkShaderStageFlags stageFlags,
-                uint32_t count = 1);
+                uint32_t count = 1,
+                VkDescriptorBindingFlags bindingFlags = 0);
+            Builder& setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
             std::unique_ptr<LvDescriptorSetLayout> build() const;
 
         private:
             LvDevice& device;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>
                 bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags>
+                bindingFlags{};
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
         };
         
         LvDescriptorSetLayout(
             LvDevice& lvDevice,
-            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>bindings);
+            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>&
+                bindingFlags = {},
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0);
         ~LvDescriptorSetLayout();
         LvDescriptorSetLayout(const LvDescriptorSetLayout&) = delete;
         LvDescriptorSetLayout& operator=(const LvDescriptorSetLayout&) 
@@ -104,7 +112,8 @@ namespace lv
         LvDescriptorWriter& writeImage(
             uint32_t binding,
             VkDescriptorType type,
-            VkDescriptorImageInfo* imageInfo);
+            VkDescriptorImageInfo* imageInfo,
+            uint32_t arrayElement = 0);
 
         bool build(VkDescriptorSet& set);
         void overwrite(VkDescriptorSet& set);
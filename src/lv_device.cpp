@@ -1,4 +1,9 @@
 #include "lv_device.hpp"
+#include "lv_geometry_arena.hpp"
+#include "lv_sampler_cache.hpp"
+#include "lv_staging_ring.hpp"
+#include "lv_texture_table.hpp"
+#include "lv_upload_batch.hpp"
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -15,10 +20,22 @@ namespace lv
 		pickPhysicalDevice();
 		createLogicalDevice();
 		createCommandPool();
+
+		memoryAllocator = std::make_unique<LvMemoryAllocator>(
+			physicalDevice, device);
+		stagingRing = std::make_unique<LvStagingRing>(*this);
+		geometryArena = std::make_unique<LvGeometryArena>(*this);
+		samplerCache = std::make_unique<LvSamplerCache>(*this);
+		textureTable = std::make_unique<LvTextureTable>(*this);
 	}
 
 	LvDevice::~LvDevice()
 	{
+		textureTable.reset();
+		samplerCache.reset();
+		geometryArena.reset();
+		stagingRing.reset();
+		memoryAllocator.reset();
 		cleanup();
 	}
 
@@ -34,7 +51,7 @@ namespace lv
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		appInfo.apiVersion = VK_API_VERSION_1_2;
 
 		VkInstanceCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -76,6 +93,8 @@ namespace lv
 			destroyDebugUtilsMessengerEXT(vkInstance, debugMessenger, nullptr);
 		}
 		
+		if (transferCommandPool != commandPool)
+			vkDestroyCommandPool(device, transferCommandPool, nullptr);
 		vkDestroyCommandPool(device, commandPool, nullptr);
 		vkDestroyDevice(device, nullptr);
 		vkDestroySurfaceKHR(vkInstance, surface, nullptr);
@@ -231,6 +250,25 @@ namespace lv
 		VkPhysicalDeviceFeatures supportedFeatures;
 		vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
+		// the texture table needs descriptor indexing, core in 1.2
+		bool descriptorIndexingSupported = false;
+		if (deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+		{
+			VkPhysicalDeviceVulkan12Features vulkan12Features{};
+			vulkan12Features.sType =
+				VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+			VkPhysicalDeviceFeatures2 features2{};
+			features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features2.pNext = &vulkan12Features;
+			vkGetPhysicalDeviceFeatures2(device, &features2);
+
+			descriptorIndexingSupported = vulkan12Features.descriptorIndexing
+				&& vulkan12Features.runtimeDescriptorArray
+				&& vulkan12Features.descriptorBindingPartiallyBound
+				&& vulkan12Features.descriptorBindingSampledImageUpdateAfterBind
+				&& vulkan12Features.descriptorBindingUpdateUnusedWhilePending;
+		}
+
 		bool swapChainAdequate = false;
 		if (allDeviceExtensionSupported)
 		{
@@ -242,7 +280,10 @@ namespace lv
 		return indicesComplte
 			&& allDeviceExtensionSupported
 			&& swapChainAdequate
-			&& supportedFeatures.samplerAnisotropy;
+			&& supportedFeatures.samplerAnisotropy
+			// the fragment shader picks its texture table slot per draw
+			&& supportedFeatures.shaderSampledImageArrayDynamicIndexing
+			&& descriptorIndexingSupported;
 	}
 
 	void LvDevice::pickPhysicalDevice()
@@ -301,6 +342,17 @@ namespace lv
 			if (hasPresentSupport)
 				indices.presentFamily = index;
 
+			// prefer a pure copy family over an async compute one
+			if ((family.queueFlags & VK_QUEUE_TRANSFER_BIT)
+				&& !(family.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+			{
+				if (!indices.transferFamily.has_value()
+					|| !(family.queueFlags & VK_QUEUE_COMPUTE_BIT))
+				{
+					indices.transferFamily = index;
+				}
+			}
+
 			++index;
 		}
 
@@ -315,6 +367,8 @@ namespace lv
 			indices.graphicsFamily.value(),
 			indices.presentFamily.value()
 		};
+		if (indices.transferFamily.has_value())
+			uniqueFamilyIndices.insert(indices.transferFamily.value());
 		std::vector<VkDeviceQueueCreateInfo> queuesCreateInfo;
 
 		float queuePriority = 1.0;
@@ -329,10 +383,29 @@ namespace lv
 			queuesCreateInfo.push_back(queueCreateInfo);
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
 		VkPhysicalDeviceFeatures deviceFeatures{};
+		// optional, textures stay uncompressed without it
+		deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+		isTextureCompressionBCEnabled = supportedFeatures.textureCompressionBC != VK_FALSE;
+		// checked in isDeviceSuitable
+		deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+
+		// checked in isDeviceSuitable
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType =
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vulkan12Features.descriptorIndexing = VK_TRUE;
+		vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+		vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+		vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
 
 		VkDeviceCreateInfo deviceCreateInfo{};
 		deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceCreateInfo.pNext = &vulkan12Features;
 		deviceCreateInfo.queueCreateInfoCount = 
 			static_cast<uint32_t>(queuesCreateInfo.size());
 		deviceCreateInfo.pQueueCreateInfos = queuesCreateInfo.data();
@@ -364,6 +437,15 @@ namespace lv
 
 		//fetch handle for presentation queue
 		vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+		// uploads fall back to the graphics queue
+		graphicsQueueFamily = indices.graphicsFamily.value();
+		transferQueueFamily = indices.transferFamily.value_or(graphicsQueueFamily);
+		vkGetDeviceQueue(device, transferQueueFamily, 0, &transferQueue);
+
+		std::cout << "transfer queue: " << (hasDedicatedTransferQueue()
+			? "dedicated family " + std::to_string(transferQueueFamily)
+			: std::string("shared with graphics")) << std::endl;
 	}
 
 	void LvDevice::createSurface(LvWindow& window)
@@ -420,6 +502,19 @@ namespace lv
 		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create command pool!");
 		}
+
+		transferCommandPool = commandPool;
+		if (hasDedicatedTransferQueue())
+		{
+			VkCommandPoolCreateInfo transferPoolInfo{};
+			transferPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			transferPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			transferPoolInfo.queueFamilyIndex = transferQueueFamily;
+
+			if (vkCreateCommandPool(device, &transferPoolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create transfer command pool!");
+			}
+		}
 	}
 
 	void LvDevice::createBuffer(
@@ -427,7 +522,8 @@ namespace lv
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlags properties,
 		VkBuffer& buffer,
-		VkDeviceMemory& bufferMemory)
+		LvMemoryAllocator::Allocation& bufferAllocation,
+		LvMemoryAllocator::Strategy strategy)
 	{
 		VkBufferCreateInfo bufferInfo{};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -435,6 +531,17 @@ namespace lv
 		bufferInfo.usage = usage;
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+		// upload destinations are written by the transfer queue range by
+		// range while graphics reads the rest, share them instead of
+		// moving ownership back and forth
+		const uint32_t queueFamilies[] = { graphicsQueueFamily, transferQueueFamily };
+		if ((usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && hasDedicatedTransferQueue())
+		{
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = 2;
+			bufferInfo.pQueueFamilyIndices = queueFamilies;
+		}
+
 		if (vkCreateBuffer(
 			device,
 			&bufferInfo,
@@ -447,35 +554,29 @@ namespace lv
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(
-			memRequirements.memoryTypeBits, 
-			properties);
-
-		if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to allocate memory for vertex buffer");
-		}
+		bufferAllocation = memoryAllocator->allocate(
+			memRequirements,
+			properties,
+			LvMemoryAllocator::ResourceKind::Linear,
+			strategy);
 
-		vkBindBufferMemory(device, buffer, bufferMemory, 0);
+		vkBindBufferMemory(
+			device, 
+			buffer, 
+			bufferAllocation.memory, 
+			bufferAllocation.offset);
 	}
 
-	uint32_t LvDevice::findMemoryType(
-		uint32_t typeFilter,
-		VkMemoryPropertyFlags properties)
+	bool LvDevice::isLinearBlitSupported(VkFormat format)
 	{
-		VkPhysicalDeviceMemoryProperties memProperties;
-		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-				return i;
-			}
-		}
-
-		throw std::runtime_error("failed to find suitable memory type!");
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+		const VkFormatFeatureFlags required =
+			VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+			VK_FORMAT_FEATURE_BLIT_DST_BIT |
+			VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		return (properties.optimalTilingFeatures & required) == required;
 	}
 
 	VkFormat LvDevice::findSupportedFormat(
@@ -508,7 +609,8 @@ namespace lv
 		VkImageUsageFlags usage,
 		VkMemoryPropertyFlags properties,
 		VkImage& image,
-		VkDeviceMemory& imageMemory) {
+		LvMemoryAllocator::Allocation& imageAllocation,
+		uint32_t mipLevels) {
 
 		VkImageCreateInfo imageInfo{};
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -516,7 +618,7 @@ namespace lv
 		imageInfo.extent.width = width;
 		imageInfo.extent.height = height;
 		imageInfo.extent.depth = 1;
-		imageInfo.mipLevels = 1;
+		imageInfo.mipLevels = mipLevels;
 		imageInfo.arrayLayers = 1;
 		imageInfo.format = format;
 		imageInfo.tiling = tiling;
@@ -533,21 +635,22 @@ namespace lv
 		VkMemoryRequirements memRequirements;
 		vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-		if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate image memory!");
-		}
+		imageAllocation = memoryAllocator->allocate(
+			memRequirements,
+			properties,
+			tiling == VK_IMAGE_TILING_OPTIMAL
+				? LvMemoryAllocator::ResourceKind::Optimal
+				: LvMemoryAllocator::ResourceKind::Linear);
 
-		if (vkBindImageMemory(device, image, imageMemory, 0) != VK_SUCCESS) {
+		if (vkBindImageMemory(device, image, imageAllocation.memory, imageAllocation.offset) != VK_SUCCESS) {
 			throw std::runtime_error("failed to bind image memory!");
 		}
 	}
 
-	VkImageView LvDevice::createImageView(VkImage image, VkFormat format)
+	VkImageView LvDevice::createImageView(
+		VkImage image,
+		VkFormat format,
+		uint32_t mipLevels)
 	{
 		VkImageViewCreateInfo viewInfo{};
 		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -556,7 +659,7 @@ namespace lv
 		viewInfo.format = format;
 		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		viewInfo.subresourceRange.baseMipLevel = 0;
-		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.levelCount = mipLevels;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
 		viewInfo.subresourceRange.layerCount = 1;
 
@@ -570,109 +673,36 @@ namespace lv
 
 	void LvDevice::transitionImageWithLayout(
 		VkImage image,
-		VkFormat format,
 		VkImageLayout oldLayout,
 		VkImageLayout newLayout)
 	{
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-		VkImageMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = oldLayout;
-		barrier.newLayout = newLayout;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = image;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-
-		VkPipelineStageFlags sourceStage;
-		VkPipelineStageFlags destinationStage;
-
-		if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		}
-		else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-			sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		}
-		else {
-			throw std::runtime_error("unsupported layout transition");
-		}
-
-		vkCmdPipelineBarrier(
-			commandBuffer,
-			sourceStage, destinationStage,
-			0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier
-		);
-
-		endSingleTimeCommands(commandBuffer);
+		LvUploadBatch batch{ *this };
+		batch.transitionImageLayout(image, oldLayout, newLayout);
+		batch.wait();
 	}
 
 	void LvDevice::copyBuffer(
 		VkBuffer srcBuffer,
 		VkBuffer dstBuffer,
-		VkDeviceSize size)
+		VkDeviceSize size,
+		VkDeviceSize srcOffset,
+		VkDeviceSize dstOffset)
 	{
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-		VkBufferCopy copyRegion{};
-		copyRegion.srcOffset = 0; // Optional
-		copyRegion.dstOffset = 0; // Optional
-		copyRegion.size = size;
-		vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-		endSingleTimeCommands(commandBuffer);
+		LvUploadBatch batch{ *this };
+		batch.copyBuffer(srcBuffer, dstBuffer, size, srcOffset, dstOffset);
+		batch.wait();
 	}
 
 	void LvDevice::copyBufferToImage(
 		VkBuffer buffer,
 		VkImage image,
 		uint32_t width,
-		uint32_t height)
+		uint32_t height,
+		VkDeviceSize bufferOffset)
 	{
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-		VkBufferImageCopy region{};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-
-		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = 1;
-
-		region.imageOffset = { 0, 0, 0 };
-		region.imageExtent = {
-			width,
-			height,
-			1
-		};
-
-		vkCmdCopyBufferToImage(
-			commandBuffer,
-			buffer,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&region
-		);
-
-		endSingleTimeCommands(commandBuffer);
+		LvUploadBatch batch{ *this };
+		batch.copyBufferToImage(buffer, image, width, height, bufferOffset);
+		batch.wait();
 	}
 
 	VkCommandBuffer LvDevice::beginSingleTimeCommands()
@@ -703,8 +733,10 @@ namespace lv
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
 
-		vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(graphicsQueue);
+		// nothing is staged, the ring only provides the fence
+		auto submission = stagingRing->closeSegment(stagingRing->openSegment());
+		vkQueueSubmit(graphicsQueue, 1, &submitInfo, submission.fence);
+		stagingRing->wait(submission.segmentId);
 
 		vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 	}
@@ -3,14 +3,21 @@
 #include <vulkan/vulkan.h>
 
 #include "lv_window.hpp"
+#include "lv_memory_allocator.hpp"
 
 #include <stdexcept>
 #include <vector>
 #include <iostream>
 #include <optional>
+#include <memory>
 
 namespace lv
 {
+	class LvGeometryArena;
+	class LvStagingRing;
+	class LvSamplerCache;
+	class LvTextureTable;
+
 	struct SwapChainSupportDetails {
 		VkSurfaceCapabilitiesKHR capabilities;
 		std::vector<VkSurfaceFormatKHR> formats;
@@ -21,6 +28,8 @@ namespace lv
 	{
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
+		// transfer only family, if the device has one
+		std::optional<uint32_t> transferFamily;
 
 		bool isComplete()
 		{
@@ -41,6 +50,20 @@ namespace lv
 		VkSurfaceKHR surface;
 		VkCommandPool commandPool;
 
+		// same as the graphics ones without a dedicated transfer family
+		uint32_t graphicsQueueFamily;
+		uint32_t transferQueueFamily;
+		VkQueue transferQueue;
+		VkCommandPool transferCommandPool;
+
+		bool isTextureCompressionBCEnabled = false;
+
+		std::unique_ptr<LvMemoryAllocator> memoryAllocator;
+		std::unique_ptr<LvStagingRing> stagingRing;
+		std::unique_ptr<LvGeometryArena> geometryArena;
+		std::unique_ptr<LvSamplerCache> samplerCache;
+		std::unique_ptr<LvTextureTable> textureTable;
+
 		const std::vector<const char*> deviceExtensions {
 			VK_KHR_SWAPCHAIN_EXTENSION_NAME
 		};
@@ -69,6 +92,17 @@ namespace lv
 		VkQueue getGraphicsQueue() { return graphicsQueue; };
 		VkQueue getPresentQueue() { return presentQueue; };
 		VkCommandPool getCommandPool() { return commandPool; };
+		VkQueue getTransferQueue() { return transferQueue; };
+		VkCommandPool getTransferCommandPool() { return transferCommandPool; };
+		uint32_t getGraphicsQueueFamily() { return graphicsQueueFamily; };
+		uint32_t getTransferQueueFamily() { return transferQueueFamily; };
+		bool hasDedicatedTransferQueue() { return transferQueueFamily != graphicsQueueFamily; };
+		bool isTextureCompressionBCSupported() { return isTextureCompressionBCEnabled; };
+		LvMemoryAllocator& getMemoryAllocator() { return *memoryAllocator; };
+		LvStagingRing& getStagingRing() { return *stagingRing; };
+		LvGeometryArena& getGeometryArena() { return *geometryArena; };
+		LvSamplerCache& getSamplerCache() { return *samplerCache; };
+		LvTextureTable& getTextureTable() { return *textureTable; };
 
 		SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 		QueueFamilyIndices findQueueFamily(VkPhysicalDevice device);
@@ -77,7 +111,9 @@ namespace lv
 			VkBufferUsageFlags usage,
 			VkMemoryPropertyFlags properties,
 			VkBuffer &buffer,
-			VkDeviceMemory &bufferMemory
+			LvMemoryAllocator::Allocation &bufferAllocation,
+			LvMemoryAllocator::Strategy strategy = 
+				LvMemoryAllocator::Strategy::FreeList
 		);
 		void createImage(
 			uint32_t width,
@@ -87,24 +123,32 @@ namespace lv
 			VkImageUsageFlags usage,
 			VkMemoryPropertyFlags properties,
 			VkImage& image,
-			VkDeviceMemory& imageMemory);
-		VkImageView createImageView(VkImage image, VkFormat format);
-		void transitionImageWithLayout(
+			LvMemoryAllocator::Allocation& imageAllocation,
+			uint32_t mipLevels = 1);
+		VkImageView createImageView(
 			VkImage image,
 			VkFormat format,
+			uint32_t mipLevels = 1);
+		void transitionImageWithLayout(
+			VkImage image,
 			VkImageLayout oldLayout,
 			VkImageLayout newLayout);
+		// whether mips of format can be generated with linear blits
+		bool isLinearBlitSupported(VkFormat format);
 		VkFormat findSupportedFormat(
 			const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 		void copyBuffer(
 			VkBuffer srcBuffer,
 			VkBuffer dstBuffer,
-			VkDeviceSize size);
+			VkDeviceSize size,
+			VkDeviceSize srcOffset = 0,
+			VkDeviceSize dstOffset = 0);
 		void copyBufferToImage(
 			VkBuffer buffer,
 			VkImage image,
 			uint32_t width, 
-			uint32_t height);
+			uint32_t height,
+			VkDeviceSize bufferOffset = 0);
 
 		VkCommandBuffer beginSingleTimeCommands();
 		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
@@ -139,8 +183,5 @@ namespace lv
 		void createSurface(LvWindow& window);
 		void createCommandPool();
 
-		uint32_t findMemoryType(
-			uint32_t typeFilter,
-			VkMemoryPropertyFlags properties);
 	};
 }
\ No newline at end of file
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "lv_camera.hpp"
-#include "lv_game_object.hpp"
+#include "lv_scene.hpp"
 
 #include <vulkan/vulkan.h>
 
@@ -32,6 +32,6 @@ namespace lv
 		VkCommandBuffer commandBuffer;
 		LvCamera& camera;
 		VkDescriptorSet globalDescriptorSet;
-		LvGameObject::Map& gameObjects;
+		LvScene& scene;
 	};
 }
\ No newline at end of file
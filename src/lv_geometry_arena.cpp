@@ -0,0 +1,175 @@
+#include "lv_geometry_arena.hpp"
+#include "lv_swapchain.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace lv
+{
+	LvGeometryArena::LvGeometryArena(LvDevice& device)
+		: device{device}
+	{
+	}
+
+	LvGeometryArena::~LvGeometryArena()
+	{
+	}
+
+	LvGeometryArena::Range LvGeometryArena::allocateVertices(
+		uint32_t vertexSize,
+		uint32_t vertexCount)
+	{
+		auto& pool = vertexPools[vertexSize];
+		pool.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+		pool.elementSize = vertexSize;
+		return allocate(pool, vertexCount);
+	}
+
+	LvGeometryArena::Range LvGeometryArena::allocateIndices(
+		VkIndexType indexType,
+		uint32_t indexCount)
+	{
+		const uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16
+			? sizeof(uint16_t)
+			: sizeof(uint32_t);
+
+		auto& pool = indexPools[indexSize];
+		pool.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+		pool.elementSize = indexSize;
+		return allocate(pool, indexCount);
+	}
+
+	void LvGeometryArena::freeVertices(const Range& range)
+	{
+		if (range.count == 0) return;
+		free(vertexPools.at(range.elementSize), range);
+	}
+
+	void LvGeometryArena::freeIndices(const Range& range)
+	{
+		if (range.count == 0) return;
+		free(indexPools.at(range.elementSize), range);
+	}
+
+	void LvGeometryArena::retireVertices(const Range& range)
+	{
+		if (range.count == 0) return;
+		retiredRanges.push_back({ &vertexPools.at(range.elementSize), range, frameCount });
+	}
+
+	void LvGeometryArena::retireIndices(const Range& range)
+	{
+		if (range.count == 0) return;
+		retiredRanges.push_back({ &indexPools.at(range.elementSize), range, frameCount });
+	}
+
+	void LvGeometryArena::releaseRetired()
+	{
+		// same counting as LvTextureTable::bind, the frames recorded up
+		// to the retirement are finished once MAX_FRAMES_IN_FLIGHT more
+		// have begun
+		++frameCount;
+		while (!retiredRanges.empty()
+			&& retiredRanges.front().frame + LvSwapChain::MAX_FRAMES_IN_FLIGHT
+				< frameCount)
+		{
+			free(*retiredRanges.front().pool, retiredRanges.front().range);
+			retiredRanges.pop_front();
+		}
+	}
+
+	LvGeometryArena::Range LvGeometryArena::allocate(Pool& pool, uint32_t count)
+	{
+		Range range{};
+		range.elementSize = pool.elementSize;
+		range.count = count;
+		if (count == 0)
+			return range;
+
+		uint64_t offset = LvRangeAllocator::INVALID_OFFSET;
+		for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+		{
+			offset = pool.blocks[i].allocator.allocate(count);
+			if (offset != LvRangeAllocator::INVALID_OFFSET)
+			{
+				range.blockIndex = i;
+				break;
+			}
+		}
+
+		if (offset == LvRangeAllocator::INVALID_OFFSET)
+		{
+			// meshes larger than a block get a block of their own size
+			const uint32_t capacity = static_cast<uint32_t>(std::max<VkDeviceSize>(
+				BLOCK_SIZE / pool.elementSize, count));
+
+			Block block{
+				std::make_unique<LvBuffer>(
+					device,
+					pool.elementSize,
+					capacity,
+					pool.usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+				LvRangeAllocator{ capacity } };
+			pool.blocks.push_back(std::move(block));
+
+			range.blockIndex = static_cast<uint32_t>(pool.blocks.size() - 1);
+			offset = pool.blocks.back().allocator.allocate(count);
+			assert(offset != LvRangeAllocator::INVALID_OFFSET);
+
+			std::cout << "geometry arena: new "
+				<< (pool.usage == VK_BUFFER_USAGE_VERTEX_BUFFER_BIT ? "vertex" : "index")
+				<< " block of " << capacity << " x " << pool.elementSize
+				<< " bytes" << std::endl;
+		}
+
+		range.buffer = pool.blocks[range.blockIndex].buffer->getBuffer();
+		range.offset = static_cast<uint32_t>(offset);
+		return range;
+	}
+
+	void LvGeometryArena::free(Pool& pool, const Range& range)
+	{
+		assert(range.blockIndex < pool.blocks.size() && "range is not from this arena");
+		pool.blocks[range.blockIndex].allocator.free(range.offset, range.count);
+	}
+
+	VkDeviceSize LvGeometryArena::getAllocatedSize() const
+	{
+		VkDeviceSize size = 0;
+		for (const auto* pools : { &vertexPools, &indexPools })
+		{
+			for (const auto& kv : *pools)
+			{
+				for (const auto& block : kv.second.blocks)
+					size += block.allocator.getSize() * kv.second.elementSize;
+			}
+		}
+		return size;
+	}
+
+	VkDeviceSize LvGeometryArena::getUsedSize() const
+	{
+		VkDeviceSize size = 0;
+		for (const auto* pools : { &vertexPools, &indexPools })
+		{
+			for (const auto& kv : *pools)
+			{
+				for (const auto& block : kv.second.blocks)
+					size += block.allocator.getUsedSize() * kv.second.elementSize;
+			}
+		}
+		return size;
+	}
+
+	uint32_t LvGeometryArena::getBlockCount() const
+	{
+		size_t count = 0;
+		for (const auto& kv : vertexPools)
+			count += kv.second.blocks.size();
+		for (const auto& kv : indexPools)
+			count += kv.second.blocks.size();
+		return static_cast<uint32_t>(count);
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "lv_device.hpp"
+#include "lv_buffer.hpp"
+#include "lv_range_allocator.hpp"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace lv
+{
+	// Suballocates model vertices and indices from a few large device
+	// local buffers. Ranges are counted in elements, so a range offset
+	// is directly usable as vertexOffset / firstIndex of a draw.
+	class LvGeometryArena
+	{
+	public:
+		static constexpr VkDeviceSize BLOCK_SIZE = 32 * 1024 * 1024;
+
+		struct Range
+		{
+			VkBuffer buffer = VK_NULL_HANDLE;
+			uint32_t elementSize = 0;
+			uint32_t blockIndex = 0;
+			uint32_t offset = 0;
+			uint32_t count = 0;
+		};
+
+	private:
+		struct Block
+		{
+			std::unique_ptr<LvBuffer> buffer;
+			LvRangeAllocator allocator;
+		};
+
+		// one pool per element size, every block of a pool holds
+		// elements of the same size
+		struct Pool
+		{
+			VkBufferUsageFlags usage;
+			uint32_t elementSize;
+			std::vector<Block> blocks;
+		};
+
+		struct RetiredRange
+		{
+			Pool* pool;
+			Range range;
+			uint64_t frame;
+		};
+
+		LvDevice& device;
+		std::map<uint32_t, Pool> vertexPools;
+		std::map<uint32_t, Pool> indexPools;
+
+		std::deque<RetiredRange> retiredRanges;
+		uint64_t frameCount = 0;
+
+	public:
+		LvGeometryArena(LvDevice& device);
+		~LvGeometryArena();
+
+		LvGeometryArena(const LvGeometryArena&) = delete;
+		LvGeometryArena& operator=(const LvGeometryArena&) = delete;
+
+		// the contents are undefined until the caller copies into the
+		// range, so every range of an upload can be reserved before the
+		// first copy is recorded
+		Range allocateVertices(
+			uint32_t vertexSize,
+			uint32_t vertexCount);
+		Range allocateIndices(
+			VkIndexType indexType,
+			uint32_t indexCount);
+		// only for ranges no frame has drawn from yet
+		void freeVertices(const Range& range);
+		void freeIndices(const Range& range);
+		// freed once the frames that could still draw from the range are
+		// finished
+		void retireVertices(const Range& range);
+		void retireIndices(const Range& range);
+		// call once per frame, after waiting on the fence of the frame
+		// MAX_FRAMES_IN_FLIGHT before it
+		void releaseRetired();
+
+		VkDeviceSize getAllocatedSize() const;
+		VkDeviceSize getUsedSize() const;
+		uint32_t getBlockCount() const;
+
+	private:
+		Range allocate(Pool& pool, uint32_t count);
+		void free(Pool& pool, const Range& range);
+	};
+}
@@ -0,0 +1,186 @@
+#include "lv_image_utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LV_IMAGE_UTILS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace lv
+{
+	// 8 bit sRGB -> 16 bit linear
+	static const std::array<uint16_t, 256>& srgbToLinearTable()
+	{
+		static const std::array<uint16_t, 256> table = []() {
+			std::array<uint16_t, 256> values{};
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.f;
+				float linear = c <= 0.04045f
+					? c / 12.92f
+					: std::pow((c + 0.055f) / 1.055f, 2.4f);
+				values[i] = static_cast<uint16_t>(std::lround(linear * 65535.f));
+			}
+			return values;
+		}();
+		return table;
+	}
+
+	// 12 bit linear -> 8 bit sRGB
+	static const std::array<uint8_t, 4096>& linearToSrgbTable()
+	{
+		static const std::array<uint8_t, 4096> table = []() {
+			std::array<uint8_t, 4096> values{};
+			for (int i = 0; i < 4096; i++)
+			{
+				float linear = (i + .5f) / 4096.f;
+				float c = linear <= 0.0031308f
+					? linear * 12.92f
+					: 1.055f * std::pow(linear, 1.f / 2.4f) - 0.055f;
+				values[i] = static_cast<uint8_t>(std::lround(std::min(c, 1.f) * 255.f));
+			}
+			return values;
+		}();
+		return table;
+	}
+
+	uint32_t LvImageUtils::mipLevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+		for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+			levels++;
+		return levels;
+	}
+
+	static void downsampleRowUnorm(
+		const uint8_t* row0,
+		const uint8_t* row1,
+		uint32_t srcWidth,
+		uint8_t* dst,
+		uint32_t dstWidth)
+	{
+		uint32_t x = 0;
+
+#ifdef LV_IMAGE_UTILS_SSE2
+		// 8 source pixels of both rows -> 4 destination pixels, rounds
+		// exactly like the scalar loop below
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i bias = _mm_set1_epi16(2);
+		auto sumPairs = [&](const uint8_t* p0, const uint8_t* p1) {
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p0));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1));
+			__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+			__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+			return _mm_srli_epi16(_mm_add_epi16(sum, bias), 2);
+		};
+
+		for (const uint32_t pairCount = srcWidth / 2; x + 4 <= pairCount; x += 4)
+		{
+			__m128i first = sumPairs(row0 + x * 8, row1 + x * 8);
+			__m128i second = sumPairs(row0 + x * 8 + 16, row1 + x * 8 + 16);
+			_mm_storeu_si128(
+				reinterpret_cast<__m128i*>(dst + x * 4),
+				_mm_packus_epi16(first, second));
+		}
+#endif
+
+		for (; x < dstWidth; x++)
+		{
+			const uint32_t x0 = std::min(x * 2, srcWidth - 1) * 4;
+			const uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1) * 4;
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+				dst[x * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+			}
+		}
+	}
+
+	static void downsampleRowSrgb(
+		const uint8_t* row0,
+		const uint8_t* row1,
+		uint32_t srcWidth,
+		uint8_t* dst,
+		uint32_t dstWidth)
+	{
+		const auto& toLinear = srgbToLinearTable();
+		const auto& toSrgb = linearToSrgbTable();
+
+		for (uint32_t x = 0; x < dstWidth; x++)
+		{
+			const uint32_t x0 = std::min(x * 2, srcWidth - 1) * 4;
+			const uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1) * 4;
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				uint32_t sum = toLinear[row0[x0 + c]] + toLinear[row0[x1 + c]]
+					+ toLinear[row1[x0 + c]] + toLinear[row1[x1 + c]];
+				dst[x * 4 + c] = toSrgb[((sum + 2) >> 2) >> 4];
+			}
+			uint32_t alpha = row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3];
+			dst[x * 4 + 3] = static_cast<uint8_t>((alpha + 2) >> 2);
+		}
+	}
+
+	void LvImageUtils::downsample(
+		const uint8_t* src,
+		uint32_t width,
+		uint32_t height,
+		uint8_t* dst,
+		bool isSrgb)
+	{
+		const uint32_t dstWidth = std::max(width / 2, 1u);
+		const uint32_t dstHeight = std::max(height / 2, 1u);
+		const size_t srcStride = static_cast<size_t>(width) * 4;
+		const size_t dstStride = static_cast<size_t>(dstWidth) * 4;
+
+		for (uint32_t y = 0; y < dstHeight; y++)
+		{
+			const uint8_t* row0 = src + std::min(y * 2, height - 1) * srcStride;
+			const uint8_t* row1 = src + std::min(y * 2 + 1, height - 1) * srcStride;
+			uint8_t* dstRow = dst + y * dstStride;
+
+			if (isSrgb)
+				downsampleRowSrgb(row0, row1, width, dstRow, dstWidth);
+			else
+				downsampleRowUnorm(row0, row1, width, dstRow, dstWidth);
+		}
+	}
+
+	LvImageUtils::MipChain LvImageUtils::buildMipChain(
+		const uint8_t* pixels,
+		uint32_t width,
+		uint32_t height,
+		bool isSrgb)
+	{
+		MipChain chain{};
+
+		size_t size = 0;
+		for (uint32_t w = width, h = height; w > 1 || h > 1;)
+		{
+			w = std::max(w / 2, 1u);
+			h = std::max(h / 2, 1u);
+			chain.levels.push_back({ size, w, h });
+			size += static_cast<size_t>(w) * h * 4;
+		}
+		chain.data.resize(size);
+
+		const uint8_t* src = pixels;
+		uint32_t srcWidth = width;
+		uint32_t srcHeight = height;
+		for (const auto& level : chain.levels)
+		{
+			uint8_t* dst = chain.data.data() + level.offset;
+			downsample(src, srcWidth, srcHeight, dst, isSrgb);
+
+			src = dst;
+			srcWidth = level.width;
+			srcHeight = level.height;
+		}
+
+		return chain;
+	}
+}
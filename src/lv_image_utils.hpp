@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lv
+{
+	// CPU side image processing on tightly packed RGBA8 pixels, used where
+	// the GPU cannot generate mips and by offline cache builders
+	class LvImageUtils
+	{
+	public:
+		struct MipLevel
+		{
+			size_t offset; // into MipChain::data
+			uint32_t width;
+			uint32_t height;
+		};
+
+		// levels 1 and below, level 0 stays with the source pixels
+		struct MipChain
+		{
+			std::vector<uint8_t> data;
+			std::vector<MipLevel> levels;
+		};
+
+		static uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+		// 2x2 box filter, dst is max(width / 2, 1) x max(height / 2, 1).
+		// Odd edges repeat their last row / column. With isSrgb the color
+		// channels are averaged in linear space, alpha never is.
+		static void downsample(
+			const uint8_t* src,
+			uint32_t width,
+			uint32_t height,
+			uint8_t* dst,
+			bool isSrgb);
+
+		static MipChain buildMipChain(
+			const uint8_t* pixels,
+			uint32_t width,
+			uint32_t height,
+			bool isSrgb);
+	};
+}
@@ -0,0 +1,128 @@
+#include "lv_mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lv
+{
+	LvMappedFile::~LvMappedFile()
+	{
+		close();
+	}
+
+#ifdef _WIN32
+	bool LvMappedFile::open(const std::string& filepath)
+	{
+		close();
+
+		HANDLE file = CreateFileA(
+			filepath.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(
+			file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		fileHandle = file;
+		mappingHandle = mapping;
+		mappedData = view;
+		mappedSize = static_cast<size_t>(fileSize.QuadPart);
+		return true;
+	}
+
+	void LvMappedFile::close()
+	{
+		if (mappedData)
+			UnmapViewOfFile(mappedData);
+		if (mappingHandle)
+			CloseHandle(mappingHandle);
+		if (fileHandle)
+			CloseHandle(fileHandle);
+
+		mappedData = nullptr;
+		mappedSize = 0;
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+	}
+#else
+	bool LvMappedFile::open(const std::string& filepath)
+	{
+		close();
+
+		int fd = ::open(filepath.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat fileStat{};
+		if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		void* view = mmap(
+			nullptr,
+			static_cast<size_t>(fileStat.st_size),
+			PROT_READ,
+			MAP_PRIVATE,
+			fd,
+			0);
+		if (view == MAP_FAILED)
+		{
+			::close(fd);
+			return false;
+		}
+
+		fileDescriptor = fd;
+		mappedData = view;
+		mappedSize = static_cast<size_t>(fileStat.st_size);
+		return true;
+	}
+
+	void LvMappedFile::close()
+	{
+		if (mappedData)
+			munmap(const_cast<void*>(mappedData), mappedSize);
+		if (fileDescriptor >= 0)
+			::close(fileDescriptor);
+
+		mappedData = nullptr;
+		mappedSize = 0;
+		fileDescriptor = -1;
+	}
+#endif
+}
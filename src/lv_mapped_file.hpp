@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace lv
+{
+	// Read-only memory mapping of a whole file. The view stays valid
+	// for the lifetime of the object.
+	class LvMappedFile
+	{
+	private:
+		const void* mappedData = nullptr;
+		size_t mappedSize = 0;
+
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+
+	public:
+		LvMappedFile() = default;
+		~LvMappedFile();
+
+		LvMappedFile(const LvMappedFile&) = delete;
+		LvMappedFile& operator=(const LvMappedFile&) = delete;
+
+		bool open(const std::string& filepath);
+		void close();
+
+		bool isOpen() const { return mappedData != nullptr; }
+		const void* data() const { return mappedData; }
+		size_t size() const { return mappedSize; }
+	};
+}
@@ -0,0 +1,323 @@
+#include "lv_memory_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace lv
+{
+	static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	LvMemoryAllocator::LvMemoryAllocator(
+		VkPhysicalDevice physicalDevice,
+		VkDevice device)
+		: physicalDevice{physicalDevice}, device{device}
+	{
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		nonCoherentAtomSize = std::max<VkDeviceSize>(
+			properties.limits.nonCoherentAtomSize, 1);
+	}
+
+	LvMemoryAllocator::~LvMemoryAllocator()
+	{
+		for (auto& kv : pools)
+		{
+			for (auto& block : kv.second.blocks)
+			{
+				if (block->allocationCount > 0)
+				{
+					std::cerr << "memory allocator: " << block->allocationCount
+						<< " allocations leaked" << std::endl;
+				}
+				destroyBlock(*block);
+			}
+		}
+	}
+
+	uint32_t LvMemoryAllocator::findMemoryType(
+		uint32_t typeFilter,
+		VkMemoryPropertyFlags properties) const
+	{
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	VkDeviceSize LvMemoryAllocator::getBlockSize(uint32_t memoryTypeIndex) const
+	{
+		// small heaps (e.g. the 256 MiB device local + host visible one)
+		// should not be taken over by a few blocks
+		const uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+		const VkDeviceSize heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+		return std::min(DEFAULT_BLOCK_SIZE, std::max<VkDeviceSize>(heapSize / 8, 1));
+	}
+
+	LvMemoryAllocator::Allocation LvMemoryAllocator::allocate(
+		const VkMemoryRequirements& requirements,
+		VkMemoryPropertyFlags properties,
+		ResourceKind kind,
+		Strategy strategy)
+	{
+		const uint32_t memoryTypeIndex = findMemoryType(
+			requirements.memoryTypeBits, properties);
+		const VkMemoryPropertyFlags typeFlags =
+			memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+		// non coherent ranges are flushed in whole atoms, keep them
+		// from reaching into a neighbour
+		VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+		if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			&& !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+		{
+			alignment = std::max(alignment, nonCoherentAtomSize);
+		}
+
+		const uint32_t poolKey = memoryTypeIndex * 4
+			+ static_cast<uint32_t>(kind) * 2
+			+ static_cast<uint32_t>(strategy);
+
+		std::lock_guard<std::mutex> lock(poolsMutex);
+
+		Pool& pool = pools[poolKey];
+		pool.memoryTypeIndex = memoryTypeIndex;
+		pool.strategy = strategy;
+
+		Allocation allocation{};
+		const VkDeviceSize blockSize = getBlockSize(memoryTypeIndex);
+
+		// anything over half a block gets its own memory object
+		if (requirements.size > blockSize / 2)
+		{
+			Block* block = createBlock(pool, poolKey, requirements.size, true);
+			allocateFromBlock(*block, strategy, requirements, alignment, allocation);
+			return allocation;
+		}
+
+		for (auto& block : pool.blocks)
+		{
+			if (block->isDedicated) continue;
+			if (allocateFromBlock(*block, strategy, requirements, alignment, allocation))
+				return allocation;
+		}
+
+		Block* block = createBlock(pool, poolKey, blockSize, false);
+		if (!allocateFromBlock(*block, strategy, requirements, alignment, allocation))
+			throw std::runtime_error("failed to suballocate memory from a new block");
+		return allocation;
+	}
+
+	bool LvMemoryAllocator::allocateFromBlock(
+		Block& block,
+		Strategy strategy,
+		const VkMemoryRequirements& requirements,
+		VkDeviceSize alignment,
+		Allocation& allocation)
+	{
+		VkDeviceSize offset;
+		if (strategy == Strategy::Linear)
+		{
+			offset = alignUp(block.linearOffset, alignment);
+			if (offset + requirements.size > block.size)
+				return false;
+			block.linearOffset = offset + requirements.size;
+		}
+		else
+		{
+			offset = block.freeRanges.allocate(requirements.size, alignment);
+			if (offset == LvRangeAllocator::INVALID_OFFSET)
+				return false;
+		}
+
+		block.allocationCount += 1;
+		block.usedBytes += requirements.size;
+
+		allocation.memory = block.memory;
+		allocation.offset = offset;
+		allocation.size = requirements.size;
+		allocation.mapped = block.mapped != nullptr
+			? static_cast<char*>(block.mapped) + offset
+			: nullptr;
+		allocation.block = &block;
+		return true;
+	}
+
+	void LvMemoryAllocator::free(Allocation& allocation)
+	{
+		if (allocation.block == nullptr)
+			return;
+
+		std::lock_guard<std::mutex> lock(poolsMutex);
+
+		Block& block = *allocation.block;
+		Pool& pool = pools.at(block.poolKey);
+
+		if (pool.strategy == Strategy::FreeList)
+			block.freeRanges.free(allocation.offset, allocation.size);
+
+		assert(block.allocationCount > 0 && "block has no live allocations");
+		block.allocationCount -= 1;
+		block.usedBytes -= allocation.size;
+		allocation = Allocation{};
+
+		if (block.allocationCount > 0)
+			return;
+
+		block.linearOffset = 0;
+
+		// release dedicated blocks and empty blocks other than the first
+		// of a pool, which stays around to avoid allocation churn
+		const bool isFirst = !pool.blocks.empty() && pool.blocks.front().get() == &block;
+		if (block.isDedicated || !isFirst)
+		{
+			destroyBlock(block);
+			pool.blocks.erase(std::find_if(
+				pool.blocks.begin(),
+				pool.blocks.end(),
+				[&block](const std::unique_ptr<Block>& other) {
+					return other.get() == &block;
+				}));
+		}
+	}
+
+	LvMemoryAllocator::Block* LvMemoryAllocator::createBlock(
+		Pool& pool,
+		uint32_t poolKey,
+		VkDeviceSize size,
+		bool isDedicated)
+	{
+		auto block = std::make_unique<Block>(size);
+		block->poolKey = poolKey;
+		block->isDedicated = isDedicated;
+
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = pool.memoryTypeIndex;
+
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate device memory block");
+		}
+
+		const VkMemoryPropertyFlags typeFlags =
+			memoryProperties.memoryTypes[pool.memoryTypeIndex].propertyFlags;
+		if (typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			if (vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS)
+			{
+				vkFreeMemory(device, block->memory, nullptr);
+				throw std::runtime_error("failed to map device memory block");
+			}
+		}
+
+		pool.blocks.push_back(std::move(block));
+		return pool.blocks.back().get();
+	}
+
+	void LvMemoryAllocator::destroyBlock(Block& block)
+	{
+		if (block.mapped != nullptr)
+		{
+			vkUnmapMemory(device, block.memory);
+			block.mapped = nullptr;
+		}
+		vkFreeMemory(device, block.memory, nullptr);
+		block.memory = VK_NULL_HANDLE;
+	}
+
+	VkMappedMemoryRange LvMemoryAllocator::getMappedRange(
+		const Allocation& allocation,
+		VkDeviceSize size,
+		VkDeviceSize offset) const
+	{
+		assert(allocation.block != nullptr && "allocation is empty");
+
+		if (size == VK_WHOLE_SIZE)
+			size = allocation.size - offset;
+
+		// expand to whole atoms, clamped to the end of the memory object
+		const VkDeviceSize begin = (allocation.offset + offset)
+			/ nonCoherentAtomSize * nonCoherentAtomSize;
+		const VkDeviceSize end = std::min(
+			alignUp(allocation.offset + offset + size, nonCoherentAtomSize),
+			allocation.block->size);
+
+		VkMappedMemoryRange mappedRange{};
+		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		mappedRange.memory = allocation.memory;
+		mappedRange.offset = begin;
+		mappedRange.size = end == allocation.block->size ? VK_WHOLE_SIZE : end - begin;
+		return mappedRange;
+	}
+
+	VkResult LvMemoryAllocator::flush(
+		const Allocation& allocation,
+		VkDeviceSize size,
+		VkDeviceSize offset)
+	{
+		VkMappedMemoryRange mappedRange = getMappedRange(allocation, size, offset);
+		return vkFlushMappedMemoryRanges(device, 1, &mappedRange);
+	}
+
+	VkResult LvMemoryAllocator::invalidate(
+		const Allocation& allocation,
+		VkDeviceSize size,
+		VkDeviceSize offset)
+	{
+		VkMappedMemoryRange mappedRange = getMappedRange(allocation, size, offset);
+		return vkInvalidateMappedMemoryRanges(device, 1, &mappedRange);
+	}
+
+	LvMemoryAllocator::Stats LvMemoryAllocator::getStats() const
+	{
+		std::lock_guard<std::mutex> lock(poolsMutex);
+
+		Stats stats{};
+		VkDeviceSize freeBytes = 0;
+		VkDeviceSize largestFreeRanges = 0;
+
+		for (const auto& kv : pools)
+		{
+			for (const auto& block : kv.second.blocks)
+			{
+				stats.blockCount += 1;
+				stats.dedicatedBlockCount += block->isDedicated ? 1 : 0;
+				stats.allocationCount += block->allocationCount;
+				stats.blockBytes += block->size;
+				stats.usedBytes += block->usedBytes;
+
+				if (kv.second.strategy == Strategy::FreeList && !block->isDedicated)
+				{
+					freeBytes += block->size - block->usedBytes;
+					largestFreeRanges += block->freeRanges.getLargestFreeRange();
+				}
+			}
+		}
+
+		if (freeBytes > 0)
+			stats.fragmentation = 1.f - float(largestFreeRanges) / float(freeBytes);
+		return stats;
+	}
+
+	void LvMemoryAllocator::printStats() const
+	{
+		const Stats stats = getStats();
+		std::cout << "device memory: " << stats.blockCount << " blocks ("
+			<< stats.dedicatedBlockCount << " dedicated), "
+			<< stats.allocationCount << " allocations, "
+			<< stats.usedBytes / (1024.f * 1024.f) << " / "
+			<< stats.blockBytes / (1024.f * 1024.f) << " MiB used, "
+			<< stats.fragmentation * 100.f << "% fragmented" << std::endl;
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "lv_range_allocator.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lv
+{
+	// Suballocates device memory from large blocks per memory type.
+	// Buffers and optimal tiling images never share a block, so
+	// bufferImageGranularity does not have to be tracked per range.
+	// Host visible blocks stay mapped for their whole lifetime.
+	class LvMemoryAllocator
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+		enum class ResourceKind : uint32_t
+		{
+			Linear,  // buffers and linear tiling images
+			Optimal  // optimal tiling images
+		};
+
+		enum class Strategy : uint32_t
+		{
+			FreeList, // long lived resources, freed ranges are reused
+			Linear    // short lived resources such as staging buffers,
+			          // a block is reused once all of its ranges are freed
+		};
+
+		struct Block;
+
+		struct Allocation
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			void* mapped = nullptr; // at offset, host visible memory only
+			Block* block = nullptr;
+		};
+
+		struct Stats
+		{
+			uint32_t blockCount = 0;
+			uint32_t dedicatedBlockCount = 0;
+			uint32_t allocationCount = 0;
+			VkDeviceSize blockBytes = 0;
+			VkDeviceSize usedBytes = 0;
+			// share of free bytes in free list blocks that is not part of
+			// the largest free range of its block
+			float fragmentation = 0.f;
+		};
+
+		struct Block
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			void* mapped = nullptr;
+			uint32_t poolKey = 0;
+			bool isDedicated = false;
+
+			LvRangeAllocator freeRanges;
+			VkDeviceSize linearOffset = 0;
+			uint32_t allocationCount = 0;
+			VkDeviceSize usedBytes = 0;
+
+			explicit Block(VkDeviceSize size) : size{size}, freeRanges{size} {}
+		};
+
+	private:
+		struct Pool
+		{
+			uint32_t memoryTypeIndex;
+			Strategy strategy;
+			std::vector<std::unique_ptr<Block>> blocks;
+		};
+
+		VkPhysicalDevice physicalDevice;
+		VkDevice device;
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		VkDeviceSize nonCoherentAtomSize;
+
+		std::map<uint32_t, Pool> pools;
+		mutable std::mutex poolsMutex;
+
+	public:
+		LvMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+		~LvMemoryAllocator();
+
+		LvMemoryAllocator(const LvMemoryAllocator&) = delete;
+		LvMemoryAllocator& operator=(const LvMemoryAllocator&) = delete;
+
+		Allocation allocate(
+			const VkMemoryRequirements& requirements,
+			VkMemoryPropertyFlags properties,
+			ResourceKind kind,
+			Strategy strategy = Strategy::FreeList);
+		void free(Allocation& allocation);
+
+		// ranges are relative to the allocation, VK_WHOLE_SIZE covers
+		// the rest of it
+		VkResult flush(
+			const Allocation& allocation,
+			VkDeviceSize size = VK_WHOLE_SIZE,
+			VkDeviceSize offset = 0);
+		VkResult invalidate(
+			const Allocation& allocation,
+			VkDeviceSize size = VK_WHOLE_SIZE,
+			VkDeviceSize offset = 0);
+
+		uint32_t findMemoryType(
+			uint32_t typeFilter,
+			VkMemoryPropertyFlags properties) const;
+
+		Stats getStats() const;
+		void printStats() const;
+
+	private:
+		Block* createBlock(
+			Pool& pool,
+			uint32_t poolKey,
+			VkDeviceSize size,
+			bool isDedicated);
+		void destroyBlock(Block& block);
+		bool allocateFromBlock(
+			Block& block,
+			Strategy strategy,
+			const VkMemoryRequirements& requirements,
+			VkDeviceSize alignment,
+			Allocation& allocation);
+		VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+		VkMappedMemoryRange getMappedRange(
+			const Allocation& allocation,
+			VkDeviceSize size,
+			VkDeviceSize offset) const;
+	};
+}
@@ -0,0 +1,152 @@
+#include "lv_mesh_cache.hpp"
+#include "lv_utils.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace lv
+{
+	static constexpr char MESH_CACHE_MAGIC[4] = { 'L', 'V', 'M', 'C' };
+
+	std::string LvMeshCache::getCachePath(const std::string& sourcePath)
+	{
+		return sourcePath + ".lvmesh";
+	}
+
+	bool LvMeshCache::hashSourceFile(
+		const std::string& sourcePath,
+		uint64_t& hash)
+	{
+		LvMappedFile sourceFile;
+		if (!sourceFile.open(sourcePath))
+			return false;
+
+		hash = hashBytes(sourceFile.data(), sourceFile.size());
+		return true;
+	}
+
+	bool LvMeshCache::load(
+		const std::string& sourcePath,
+		uint32_t buildFlags,
+		LvMappedFile& cacheFile)
+	{
+		std::error_code ec;
+		const uint64_t sourceSize = std::filesystem::file_size(sourcePath, ec);
+		if (ec) return false;
+		const int64_t sourceTime = std::filesystem::last_write_time(
+			sourcePath, ec).time_since_epoch().count();
+		if (ec) return false;
+
+		if (!cacheFile.open(getCachePath(sourcePath)))
+			return false;
+
+		bool valid = cacheFile.size() >= sizeof(Header);
+		if (valid)
+		{
+			const Header& header = getHeader(cacheFile);
+			const uint64_t expectedSize = sizeof(Header)
+				+ uint64_t(header.vertexCount) * header.vertexStride
+				+ uint64_t(header.indexCount) * sizeof(uint32_t);
+
+			valid = memcmp(header.magic, MESH_CACHE_MAGIC, 4) == 0
+				&& header.version == VERSION
+				&& header.vertexStride == sizeof(LvModel::Vertex)
+				&& header.buildFlags == buildFlags
+				&& header.sourceSize == sourceSize
+				&& expectedSize == cacheFile.size();
+
+			// a touched but unchanged source (e.g. after a checkout)
+			// keeps its cache, only then the source is hashed
+			uint64_t sourceHash = 0;
+			if (valid && header.sourceTime != sourceTime)
+			{
+				valid = hashSourceFile(sourcePath, sourceHash)
+					&& sourceHash == header.sourceHash;
+			}
+		}
+
+		if (!valid)
+			cacheFile.close();
+		return valid;
+	}
+
+	void LvMeshCache::store(
+		const std::string& sourcePath,
+		const LvModel::Builder& builder)
+	{
+		Header header{};
+		memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+		header.version = VERSION;
+
+		std::error_code ec;
+		header.sourceSize = std::filesystem::file_size(sourcePath, ec);
+		if (ec) return;
+		header.sourceTime = std::filesystem::last_write_time(
+			sourcePath, ec).time_since_epoch().count();
+		if (ec) return;
+		if (!hashSourceFile(sourcePath, header.sourceHash))
+			return;
+
+		header.vertexStride = sizeof(LvModel::Vertex);
+		header.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+		header.indexCount = static_cast<uint32_t>(builder.indices.size());
+		header.buildFlags = builder.getBuildFlags();
+
+		// write to a temporary file first so a half written cache is
+		// never picked up by a later load, the name is per thread since
+		// Standard and Packed loads of one model can store at once
+		const std::string cachePath = getCachePath(sourcePath);
+		const std::string tempPath = cachePath + "."
+			+ std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()))
+			+ ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return;
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(
+				reinterpret_cast<const char*>(builder.vertices.data()),
+				builder.vertices.size() * sizeof(LvModel::Vertex));
+			file.write(
+				reinterpret_cast<const char*>(builder.indices.data()),
+				builder.indices.size() * sizeof(uint32_t));
+
+			if (!file.good())
+			{
+				file.close();
+				std::filesystem::remove(tempPath, ec);
+				return;
+			}
+		}
+
+		std::filesystem::rename(tempPath, cachePath, ec);
+		if (ec)
+			std::filesystem::remove(tempPath, ec);
+	}
+
+	const LvMeshCache::Header& LvMeshCache::getHeader(
+		const LvMappedFile& cacheFile)
+	{
+		return *static_cast<const Header*>(cacheFile.data());
+	}
+
+	const LvModel::Vertex* LvMeshCache::getVertices(
+		const LvMappedFile& cacheFile)
+	{
+		const char* base = static_cast<const char*>(cacheFile.data());
+		return reinterpret_cast<const LvModel::Vertex*>(base + sizeof(Header));
+	}
+
+	const uint32_t* LvMeshCache::getIndices(const LvMappedFile& cacheFile)
+	{
+		const char* base = static_cast<const char*>(cacheFile.data());
+		const Header& header = getHeader(cacheFile);
+		return reinterpret_cast<const uint32_t*>(
+			base + sizeof(Header)
+			+ size_t(header.vertexCount) * header.vertexStride);
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "lv_model.hpp"
+#include "lv_mapped_file.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace lv
+{
+	// Binary cache of a deduplicated mesh, stored next to the source
+	// file as "<source>.lvmesh". Layout is the header followed by the
+	// vertex array and the uint32 index array, so a mapped cache can be
+	// copied straight into a staging buffer.
+	class LvMeshCache
+	{
+	public:
+		static constexpr uint32_t VERSION = 2;
+
+		struct Header
+		{
+			char magic[4];
+			uint32_t version;
+			uint64_t sourceSize;
+			int64_t sourceTime;
+			uint64_t sourceHash;
+			uint32_t vertexStride;
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			uint32_t buildFlags; // LvModel::Builder::getBuildFlags
+		};
+
+		// maps the cache of sourcePath, fails if it is missing or stale
+		static bool load(
+			const std::string& sourcePath,
+			uint32_t buildFlags,
+			LvMappedFile& cacheFile);
+		static void store(
+			const std::string& sourcePath,
+			const LvModel::Builder& builder);
+
+		static std::string getCachePath(const std::string& sourcePath);
+		static const Header& getHeader(const LvMappedFile& cacheFile);
+		static const LvModel::Vertex* getVertices(
+			const LvMappedFile& cacheFile);
+		static const uint32_t* getIndices(const LvMappedFile& cacheFile);
+
+	private:
+		static bool hashSourceFile(
+			const std::string& sourcePath,
+			uint64_t& hash);
+	};
+}
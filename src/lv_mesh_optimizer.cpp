@@ -0,0 +1,371 @@
+#include "lv_mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+namespace lv
+{
+	LvMeshOptimizer::CacheStats LvMeshOptimizer::analyzeVertexCache(
+		const std::vector<uint32_t>& indices,
+		size_t vertexCount,
+		uint32_t cacheSize)
+	{
+		CacheStats stats{ 0.f, 0.f };
+		if (indices.empty())
+			return stats;
+
+		// a vertex is in the cache while fewer than cacheSize misses
+		// happened after it was loaded
+		std::vector<uint32_t> loadedAt(vertexCount, 0);
+		std::vector<bool> isReferenced(vertexCount, false);
+		uint32_t misses = 0;
+		uint32_t referencedCount = 0;
+
+		for (uint32_t index : indices)
+		{
+			if (!isReferenced[index])
+			{
+				isReferenced[index] = true;
+				++referencedCount;
+			}
+
+			if (loadedAt[index] == 0 || misses - loadedAt[index] + 1 > cacheSize)
+			{
+				++misses;
+				loadedAt[index] = misses;
+			}
+		}
+
+		stats.acmr = float(misses) / float(indices.size() / 3);
+		stats.atvr = float(misses) / float(referencedCount);
+		return stats;
+	}
+
+	LvMeshOptimizer::OverdrawStats LvMeshOptimizer::analyzeOverdraw(
+		const std::vector<uint32_t>& indices,
+		const std::vector<LvModel::Vertex>& vertices,
+		uint32_t gridSize)
+	{
+		OverdrawStats stats{ 0.f };
+		if (indices.empty() || vertices.empty())
+			return stats;
+
+		glm::vec3 minPosition = vertices[0].position;
+		glm::vec3 maxPosition = vertices[0].position;
+		for (const auto& vertex : vertices)
+		{
+			minPosition = glm::min(minPosition, vertex.position);
+			maxPosition = glm::max(maxPosition, vertex.position);
+		}
+		const glm::vec3 extent = maxPosition - minPosition;
+		const float scale = float(gridSize) / std::max({ extent.x, extent.y, extent.z, 1e-6f });
+
+		std::vector<float> depthBuffer(size_t(gridSize) * gridSize);
+		uint64_t shaded = 0;
+		uint64_t covered = 0;
+
+		// orthographic views along both directions of every axis, nothing
+		// is culled like in the pipeline
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			for (float direction : { 1.f, -1.f })
+			{
+				std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+				for (size_t t = 0; t + 2 < indices.size(); t += 3)
+				{
+					glm::vec3 p[3];
+					for (int corner = 0; corner < 3; ++corner)
+					{
+						const glm::vec3 position =
+							(vertices[indices[t + corner]].position - minPosition) * scale;
+						p[corner] = {
+							position[(axis + 1) % 3],
+							position[(axis + 2) % 3],
+							position[axis] * direction };
+					}
+
+					float area = (p[1].x - p[0].x) * (p[2].y - p[0].y)
+						- (p[1].y - p[0].y) * (p[2].x - p[0].x);
+					if (area == 0.f) continue;
+					if (area < 0.f)
+					{
+						std::swap(p[1], p[2]);
+						area = -area;
+					}
+
+					const int minX = std::max(int(std::floor(std::min({ p[0].x, p[1].x, p[2].x }))), 0);
+					const int minY = std::max(int(std::floor(std::min({ p[0].y, p[1].y, p[2].y }))), 0);
+					const int maxX = std::min(int(std::ceil(std::max({ p[0].x, p[1].x, p[2].x }))), int(gridSize) - 1);
+					const int maxY = std::min(int(std::ceil(std::max({ p[0].y, p[1].y, p[2].y }))), int(gridSize) - 1);
+
+					for (int y = minY; y <= maxY; ++y)
+					{
+						for (int x = minX; x <= maxX; ++x)
+						{
+							const float px = x + 0.5f;
+							const float py = y + 0.5f;
+							const float w0 = (p[2].x - p[1].x) * (py - p[1].y) - (p[2].y - p[1].y) * (px - p[1].x);
+							const float w1 = (p[0].x - p[2].x) * (py - p[2].y) - (p[0].y - p[2].y) * (px - p[2].x);
+							const float w2 = (p[1].x - p[0].x) * (py - p[0].y) - (p[1].y - p[0].y) * (px - p[0].x);
+							if (w0 < 0.f || w1 < 0.f || w2 < 0.f) continue;
+
+							const float depth = (w0 * p[0].z + w1 * p[1].z + w2 * p[2].z) / area;
+							float& stored = depthBuffer[size_t(y) * gridSize + x];
+							if (depth < stored)
+							{
+								if (stored == FLT_MAX) ++covered;
+								stored = depth;
+								++shaded;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		stats.overdraw = covered > 0 ? float(shaded) / float(covered) : 0.f;
+		return stats;
+	}
+
+	void LvMeshOptimizer::optimizeVertexCache(
+		std::vector<uint32_t>& indices,
+		size_t vertexCount,
+		std::vector<uint32_t>& clusterStarts,
+		uint32_t cacheSize)
+	{
+		assert(indices.size() % 3 == 0 && "expected a triangle list");
+
+		const size_t triangleCount = indices.size() / 3;
+		clusterStarts.clear();
+		if (triangleCount == 0)
+			return;
+
+		// vertex -> triangle adjacency in compressed rows
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+		for (uint32_t index : indices)
+			++liveTriangles[index];
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; ++v)
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			std::vector<uint32_t> fill(
+				adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); ++i)
+				adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> isEmitted(triangleCount, false);
+		std::vector<uint32_t> deadEnds;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		uint32_t timeStamp = cacheSize + 1;
+		size_t cursor = 0;
+		int64_t fanningVertex = 0;
+		bool startsCluster = true;
+
+		while (fanningVertex >= 0)
+		{
+			candidates.clear();
+
+			const uint32_t vertex = static_cast<uint32_t>(fanningVertex);
+			for (uint32_t a = adjacencyOffsets[vertex];
+				a < adjacencyOffsets[vertex + 1]; ++a)
+			{
+				const uint32_t triangle = adjacency[a];
+				if (isEmitted[triangle]) continue;
+
+				if (startsCluster)
+				{
+					clusterStarts.push_back(
+						static_cast<uint32_t>(output.size() / 3));
+					startsCluster = false;
+				}
+
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					const uint32_t v = indices[triangle * 3 + corner];
+					output.push_back(v);
+					deadEnds.push_back(v);
+					candidates.push_back(v);
+					--liveTriangles[v];
+
+					if (timeStamp - cacheTime[v] > cacheSize)
+					{
+						cacheTime[v] = timeStamp;
+						++timeStamp;
+					}
+				}
+				isEmitted[triangle] = true;
+			}
+
+			// prefer the oldest candidate that stays in the cache while
+			// its remaining triangles are fanned
+			int64_t nextVertex = -1;
+			int64_t bestPriority = -1;
+			for (uint32_t v : candidates)
+			{
+				if (liveTriangles[v] == 0) continue;
+
+				int64_t priority = 0;
+				if (timeStamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+					priority = timeStamp - cacheTime[v];
+
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					nextVertex = v;
+				}
+			}
+
+			if (nextVertex == -1)
+			{
+				// dead end: the fan is exhausted, so the cluster ends here.
+				// Try recently used vertices, then scan forward.
+				startsCluster = true;
+				while (!deadEnds.empty() && nextVertex == -1)
+				{
+					const uint32_t v = deadEnds.back();
+					deadEnds.pop_back();
+					if (liveTriangles[v] > 0)
+						nextVertex = v;
+				}
+
+				if (nextVertex == -1)
+				{
+					while (cursor < vertexCount && liveTriangles[cursor] == 0)
+						++cursor;
+					nextVertex = cursor < vertexCount ? int64_t(cursor) : -1;
+				}
+			}
+
+			fanningVertex = nextVertex;
+		}
+
+		assert(output.size() == indices.size());
+		indices.swap(output);
+	}
+
+	void LvMeshOptimizer::optimizeOverdraw(
+		std::vector<uint32_t>& indices,
+		const std::vector<LvModel::Vertex>& vertices,
+		const std::vector<uint32_t>& clusterStarts)
+	{
+		const size_t triangleCount = indices.size() / 3;
+		const size_t clusterCount = clusterStarts.size();
+		if (clusterCount < 2)
+			return;
+
+		struct Cluster
+		{
+			glm::vec3 centroid{ 0.f };
+			glm::vec3 normal{ 0.f };
+			float area = 0.f;
+		};
+		std::vector<Cluster> clusters(clusterCount);
+
+		glm::vec3 meshCentroid{ 0.f };
+		float meshArea = 0.f;
+
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			const size_t first = clusterStarts[c];
+			const size_t last = c + 1 < clusterCount
+				? clusterStarts[c + 1]
+				: triangleCount;
+
+			Cluster& cluster = clusters[c];
+			for (size_t t = first; t < last; ++t)
+			{
+				const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+				const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+				const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+
+				// area weighted, the cross product length is twice the area
+				const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				const float area = glm::length(normal);
+
+				cluster.centroid += (p0 + p1 + p2) * (area / 3.f);
+				cluster.normal += normal;
+				cluster.area += area;
+			}
+
+			meshCentroid += cluster.centroid;
+			meshArea += cluster.area;
+			if (cluster.area > 0.f)
+				cluster.centroid = cluster.centroid / cluster.area;
+		}
+
+		if (meshArea > 0.f)
+			meshCentroid = meshCentroid / meshArea;
+
+		std::vector<float> sortKeys(clusterCount);
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			const glm::vec3 normal = glm::length(clusters[c].normal) > 0.f
+				? glm::normalize(clusters[c].normal)
+				: glm::vec3{ 0.f };
+			sortKeys[c] = glm::dot(clusters[c].centroid - meshCentroid, normal);
+		}
+
+		std::vector<uint32_t> order(clusterCount);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return sortKeys[a] > sortKeys[b];
+		});
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+		for (uint32_t c : order)
+		{
+			const size_t first = clusterStarts[c];
+			const size_t last = c + 1 < clusterCount
+				? clusterStarts[c + 1]
+				: triangleCount;
+			output.insert(
+				output.end(),
+				indices.begin() + first * 3,
+				indices.begin() + last * 3);
+		}
+		indices.swap(output);
+	}
+
+	void LvMeshOptimizer::optimizeVertexFetch(
+		std::vector<LvModel::Vertex>& vertices,
+		std::vector<uint32_t>& indices)
+	{
+		constexpr uint32_t UNUSED = UINT32_MAX;
+		std::vector<uint32_t> remap(vertices.size(), UNUSED);
+
+		std::vector<LvModel::Vertex> output;
+		output.reserve(vertices.size());
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == UNUSED)
+			{
+				remap[index] = static_cast<uint32_t>(output.size());
+				output.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		// keep vertices the index buffer does not reference
+		for (size_t v = 0; v < vertices.size(); ++v)
+		{
+			if (remap[v] == UNUSED)
+				output.push_back(vertices[v]);
+		}
+
+		vertices.swap(output);
+	}
+}
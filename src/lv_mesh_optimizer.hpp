@@ -0,0 +1,62 @@
+#pragma once
+
+#include "lv_model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace lv
+{
+	// Index/vertex reordering passes for triangle lists, run on the CPU
+	// while a mesh is built
+	class LvMeshOptimizer
+	{
+	public:
+		static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+		struct CacheStats
+		{
+			float acmr; // cache misses per triangle
+			float atvr; // cache misses per referenced vertex
+		};
+
+		struct OverdrawStats
+		{
+			float overdraw; // shaded fragments per covered pixel
+		};
+
+		// simulates a FIFO post-transform cache of cacheSize entries
+		static CacheStats analyzeVertexCache(
+			const std::vector<uint32_t>& indices,
+			size_t vertexCount,
+			uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+		// rasterizes the triangles in index order with a depth test into a
+		// gridSize square from the six axis directions
+		static OverdrawStats analyzeOverdraw(
+			const std::vector<uint32_t>& indices,
+			const std::vector<LvModel::Vertex>& vertices,
+			uint32_t gridSize = 128);
+
+		// Tipsify (Sander et al. 2007). clusterStarts receives the first
+		// triangle of every cluster, a new one starts at every dead end
+		// where the fan could not continue from the cache.
+		static void optimizeVertexCache(
+			std::vector<uint32_t>& indices,
+			size_t vertexCount,
+			std::vector<uint32_t>& clusterStarts,
+			uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+		// sorts the clusters found by optimizeVertexCache so that outward
+		// facing clusters are drawn first
+		static void optimizeOverdraw(
+			std::vector<uint32_t>& indices,
+			const std::vector<LvModel::Vertex>& vertices,
+			const std::vector<uint32_t>& clusterStarts);
+
+		// renumbers vertices in order of first use by the index buffer
+		static void optimizeVertexFetch(
+			std::vector<LvModel::Vertex>& vertices,
+			std::vector<uint32_t>& indices);
+	};
+}
@@ -4,52 +4,340 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
 #include "lv_device.hpp"
-#include "lv_utils.hpp"
+#include "lv_geometry_arena.hpp"
+#include "lv_mesh_cache.hpp"
+#include "lv_mesh_optimizer.hpp"
+#include "lv_vertex_table.hpp"
+#include "lv_thread_pool.hpp"
 
+#include <algorithm>
 #include <cassert>
-#include <unordered_map>
-
-// injecting hash function for Vertex into std namespace
-namespace std {
-	template <>
-	struct hash<lv::LvModel::Vertex> {
-		size_t operator()(lv::LvModel::Vertex const& vertex) const {
-			size_t seed = 0;
-			lv::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
-		}
-	};
-}
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
 
 namespace lv
 {
-	LvModel::LvModel(LvDevice& device, const LvModel::Builder& builder)
-		: device{device}
+	static LvModel::Vertex assembleVertex(
+		const tinyobj::attrib_t& attrib,
+		const tinyobj::index_t& index)
+	{
+		LvModel::Vertex vertex{};
+
+		if (index.vertex_index >= 0)
+		{
+			vertex.position = {
+				attrib.vertices[3 * index.vertex_index + 0],
+				attrib.vertices[3 * index.vertex_index + 1],
+				attrib.vertices[3 * index.vertex_index + 2
+				]
+			};
+
+			vertex.color = {
+				attrib.colors[3 * index.vertex_index + 0],
+				attrib.colors[3 * index.vertex_index + 1],
+				attrib.colors[3 * index.vertex_index + 2],
+			};
+		}
+
+		if (index.normal_index >= 0)
+		{
+			vertex.normal = {
+				attrib.normals[3 * index.normal_index + 0],
+				attrib.normals[3 * index.normal_index + 1],
+				attrib.normals[3 * index.normal_index + 2
+				]
+			};
+		}
+
+		if (index.texcoord_index >= 0) {
+			vertex.uv = {
+				attrib.texcoords[2 * index.texcoord_index + 0],
+				1.0f - attrib.texcoords[2 * index.texcoord_index + 1],
+			};
+		}
+
+		return vertex;
+	}
+
+	// assembles [begin, end) of the index stream formed by all shapes,
+	// writing indices of uniqueVertices to outIndices
+	static void assembleVertices(
+		const tinyobj::attrib_t& attrib,
+		const std::vector<tinyobj::shape_t>& shapes,
+		const std::vector<size_t>& shapeOffsets,
+		size_t begin,
+		size_t end,
+		LvVertexTable& uniqueVertices,
+		uint32_t* outIndices)
+	{
+		size_t shapeIndex = std::upper_bound(
+			shapeOffsets.begin(), shapeOffsets.end(), begin)
+			- shapeOffsets.begin() - 1;
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			while (i >= shapeOffsets[shapeIndex + 1]) {
+				++shapeIndex;
+			}
+
+			const auto& index = 
+				shapes[shapeIndex].mesh.indices[i - shapeOffsets[shapeIndex]];
+			*outIndices++ = uniqueVertices.insert(
+				assembleVertex(attrib, index));
+		}
+	}
+
+	static uint16_t floatToHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		const uint32_t sign = (bits >> 16) & 0x8000u;
+		const uint32_t exponent = (bits >> 23) & 0xffu;
+		uint32_t mantissa = bits & 0x7fffffu;
+
+		if (exponent == 0xffu) // inf and nan
+			return static_cast<uint16_t>(
+				sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+
+		const int32_t halfExponent = int32_t(exponent) - 127 + 15;
+		if (halfExponent >= 0x1f) // overflow to inf
+			return static_cast<uint16_t>(sign | 0x7c00u);
+
+		if (halfExponent <= 0) // subnormal or zero
+		{
+			if (halfExponent < -10)
+				return static_cast<uint16_t>(sign);
+			mantissa |= 0x800000u;
+			const uint32_t shift = uint32_t(14 - halfExponent);
+			uint32_t half = mantissa >> shift;
+			const uint32_t rest = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			if (rest > halfway || (rest == halfway && (half & 1u)))
+				++half;
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		// round to nearest even, a carry into the exponent is correct
+		uint32_t half = (uint32_t(halfExponent) << 10) | (mantissa >> 13);
+		const uint32_t rest = mantissa & 0x1fffu;
+		if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+			++half;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	static int16_t toSnorm16(float value)
+	{
+		value = std::min(std::max(value, -1.f), 1.f);
+		return static_cast<int16_t>(std::lround(value * 32767.f));
+	}
+
+	static uint8_t toUnorm8(float value)
+	{
+		value = std::min(std::max(value, 0.f), 1.f);
+		return static_cast<uint8_t>(std::lround(value * 255.f));
+	}
+
+	static void encodeOctahedral(glm::vec3 normal, int16_t* encoded)
+	{
+		const float sum = 
+			std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (sum == 0.f)
+		{
+			encoded[0] = encoded[1] = 0;
+			return;
+		}
+		normal = normal / sum;
+
+		// fold the lower hemisphere over the diagonals
+		float x = normal.x;
+		float y = normal.y;
+		if (normal.z < 0.f)
+		{
+			x = (1.f - std::abs(normal.y)) * (normal.x >= 0.f ? 1.f : -1.f);
+			y = (1.f - std::abs(normal.x)) * (normal.y >= 0.f ? 1.f : -1.f);
+		}
+		encoded[0] = toSnorm16(x);
+		encoded[1] = toSnorm16(y);
+	}
+
+	// quantizes positions to the bounds of the mesh, positionTransform
+	// receives the matrix that maps them back
+	static std::vector<LvModel::PackedVertex> packVertices(
+		const LvModel::Vertex* vertices,
+		uint32_t vertexCount,
+		glm::mat4& positionTransform)
 	{
-		createVertexBuffers(builder.vertices);
-		createIndexBuffers(builder.indices);
+		glm::vec3 minPosition = vertices[0].position;
+		glm::vec3 maxPosition = vertices[0].position;
+		for (uint32_t i = 1; i < vertexCount; ++i)
+		{
+			const glm::vec3& position = vertices[i].position;
+			minPosition.x = std::min(minPosition.x, position.x);
+			minPosition.y = std::min(minPosition.y, position.y);
+			minPosition.z = std::min(minPosition.z, position.z);
+			maxPosition.x = std::max(maxPosition.x, position.x);
+			maxPosition.y = std::max(maxPosition.y, position.y);
+			maxPosition.z = std::max(maxPosition.z, position.z);
+		}
+
+		const glm::vec3 center = (minPosition + maxPosition) * 0.5f;
+		glm::vec3 extent = (maxPosition - minPosition) * 0.5f;
+		extent.x = std::max(extent.x, 1e-6f);
+		extent.y = std::max(extent.y, 1e-6f);
+		extent.z = std::max(extent.z, 1e-6f);
+
+		positionTransform = glm::mat4{ 1.f };
+		positionTransform[0][0] = extent.x;
+		positionTransform[1][1] = extent.y;
+		positionTransform[2][2] = extent.z;
+		positionTransform[3] = glm::vec4(center, 1.f);
+
+		std::vector<LvModel::PackedVertex> packedVertices(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			const LvModel::Vertex& vertex = vertices[i];
+			LvModel::PackedVertex& packed = packedVertices[i];
+
+			const glm::vec3 position = (vertex.position - center) / extent;
+			packed.position[0] = toSnorm16(position.x);
+			packed.position[1] = toSnorm16(position.y);
+			packed.position[2] = toSnorm16(position.z);
+			packed.position[3] = 0;
+
+			packed.color[0] = toUnorm8(vertex.color.x);
+			packed.color[1] = toUnorm8(vertex.color.y);
+			packed.color[2] = toUnorm8(vertex.color.z);
+			packed.color[3] = 255;
+
+			encodeOctahedral(vertex.normal, packed.normal);
+
+			packed.uv[0] = floatToHalf(vertex.uv.x);
+			packed.uv[1] = floatToHalf(vertex.uv.y);
+		}
+		return packedVertices;
+	}
+
+	LvModel::LvModel(
+		LvDevice& device,
+		const LvModel::Builder& builder,
+		LvUploadBatch* batch)
+		: device{device}, vertexFormat{builder.vertexFormat}
+	{
+		createBuffers(
+			builder.vertices.data(),
+			static_cast<uint32_t>(builder.vertices.size()),
+			builder.indices.data(),
+			static_cast<uint32_t>(builder.indices.size()),
+			batch);
+	}
+
+	LvModel::LvModel(
+		LvDevice& device,
+		const Vertex* vertices,
+		uint32_t vertexCount,
+		const uint32_t* indices,
+		uint32_t indexCount,
+		VertexFormat vertexFormat,
+		LvUploadBatch* batch)
+		: device{device}, vertexFormat{vertexFormat}
+	{
+		createBuffers(vertices, vertexCount, indices, indexCount, batch);
 	}
 
 	LvModel::~LvModel()
 	{
+		// frames in flight may still draw from the ranges
+		auto& geometryArena = device.getGeometryArena();
+		geometryArena.retireVertices(vertexRange);
+		geometryArena.retireIndices(indexRange);
+	}
 
+	void LvModel::loadFile(
+		const std::string& filepath,
+		VertexFormat vertexFormat,
+		uint32_t threadCount,
+		FileData& fileData)
+	{
+		Builder& modelBuilder = fileData.builder;
+		modelBuilder.threadCount = threadCount;
+		modelBuilder.optimizeMesh = true;
+		modelBuilder.optimizeOverdraw = true;
+		modelBuilder.vertexFormat = vertexFormat;
+
+		// warm path: the mapped cache is copied straight into staging
+		fileData.isCached = LvMeshCache::load(
+			filepath, modelBuilder.getBuildFlags(), fileData.cacheFile);
+		if (!fileData.isCached)
+		{
+			modelBuilder.loadModel(filepath);
+			LvMeshCache::store(filepath, modelBuilder);
+		}
+	}
+
+	std::unique_ptr<LvModel> LvModel::createModel(
+		LvDevice& device,
+		const FileData& fileData,
+		LvUploadBatch* batch)
+	{
+		if (fileData.isCached)
+		{
+			const auto& header = LvMeshCache::getHeader(fileData.cacheFile);
+			return std::make_unique<LvModel>(
+				device,
+				LvMeshCache::getVertices(fileData.cacheFile),
+				header.vertexCount,
+				LvMeshCache::getIndices(fileData.cacheFile),
+				header.indexCount,
+				fileData.builder.vertexFormat,
+				batch);
+		}
+		return std::make_unique<LvModel>(device, fileData.builder, batch);
 	}
 
 	std::unique_ptr<LvModel> LvModel::createModelFromFile(
 		LvDevice& device,
-		const std::string& filepath)
+		const std::string& filepath,
+		VertexFormat vertexFormat,
+		LvUploadBatch* batch)
 	{
-		Builder modelBuilder{};
-		modelBuilder.loadModel(filepath);
+		auto startTime = std::chrono::high_resolution_clock::now();
 
-		return std::make_unique<LvModel>(device, modelBuilder);
+		FileData fileData{};
+		loadFile(filepath, vertexFormat, LvThreadPool::defaultThreadCount(), fileData);
+		auto model = createModel(device, fileData, batch);
+
+		auto loadTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - startTime).count();
+		model->printLoadInfo(filepath, fileData.isCached, loadTime);
+
+		return model;
+	}
+
+	void LvModel::printLoadInfo(
+		const std::string& filepath,
+		bool isCached,
+		float loadTime) const
+	{
+		std::cout << "model " << filepath 
+			<< (isCached ? " (warm, cached)" : " (cold)")
+			<< " loaded in " << loadTime << " ms" << std::endl;
+		std::cout << "  " << vertexCount << " vertices "
+			<< getVertexBufferSize() / 1024.f << " KiB";
+		if (vertexFormat == VertexFormat::Packed)
+		{
+			std::cout << " packed (standard " 
+				<< vertexCount * sizeof(Vertex) / 1024.f << " KiB)";
+		}
+		std::cout << ", " << indexCount << " indices "
+			<< getIndexBufferSize() / 1024.f << " KiB" << std::endl;
 	}
 
 	void LvModel::Builder::loadModel(const std::string& filepath)
@@ -73,127 +361,260 @@ namespace lv
 		vertices.clear();
 		indices.clear();
 
-		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+		// all shapes are treated as one index stream
+		std::vector<size_t> shapeOffsets{ 0 };
 		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				Vertex vertex{};
+			shapeOffsets.push_back(
+				shapeOffsets.back() + shape.mesh.indices.size());
+		}
+		const size_t indexCount = shapeOffsets.back();
+		indices.resize(indexCount);
 
-				if (index.vertex_index >= 0)
-				{
-					vertex.position = {
-						attrib.vertices[3 * index.vertex_index + 0],
-						attrib.vertices[3 * index.vertex_index + 1],
-						attrib.vertices[3 * index.vertex_index + 2
-						]
-					};
-
-					vertex.color = {
-						attrib.colors[3 * index.vertex_index + 0],
-						attrib.colors[3 * index.vertex_index + 1],
-						attrib.colors[3 * index.vertex_index + 2],
-					};
-				}
+		const size_t maxChunkCount = 
+			(indexCount + MIN_INDICES_PER_CHUNK - 1) / MIN_INDICES_PER_CHUNK;
+		const uint32_t chunkCount = static_cast<uint32_t>(std::min<size_t>(
+			threadCount > 1 ? threadCount * 4 : 1, 
+			maxChunkCount));
+
+		if (chunkCount <= 1)
+		{
+			LvVertexTable uniqueVertices{ vertices, indexCount };
+			assembleVertices(
+				attrib, shapes, shapeOffsets, 
+				0, indexCount, 
+				uniqueVertices, indices.data());
+		}
+		else
+		{
+			// each chunk dedupes its own index range into local vertices
+			struct Chunk
+			{
+				std::vector<Vertex> vertices;
+				std::vector<uint32_t> remap;
+			};
+			std::vector<Chunk> chunks(chunkCount);
+
+			LvThreadPool threadPool{ threadCount - 1 };
+			threadPool.parallelFor(chunkCount, [&](uint32_t chunkIndex) {
+				const size_t begin = indexCount * chunkIndex / chunkCount;
+				const size_t end = indexCount * (chunkIndex + 1) / chunkCount;
+
+				LvVertexTable localVertices{ 
+					chunks[chunkIndex].vertices, 
+					end - begin };
+				assembleVertices(
+					attrib, shapes, shapeOffsets, 
+					begin, end, 
+					localVertices, indices.data() + begin);
+			});
+
+			// merging the chunks in order keeps every vertex at its first
+			// occurrence in the stream, same as the single threaded path
+			size_t localVertexCount = 0;
+			for (const auto& chunk : chunks) {
+				localVertexCount += chunk.vertices.size();
+			}
 
-				if (index.normal_index >= 0)
+			LvVertexTable uniqueVertices{ vertices, localVertexCount };
+			for (auto& chunk : chunks)
+			{
+				chunk.remap.resize(chunk.vertices.size());
+				for (size_t i = 0; i < chunk.vertices.size(); ++i)
 				{
-					vertex.normal = {
-						attrib.normals[3 * index.normal_index + 0],
-						attrib.normals[3 * index.normal_index + 1],
-						attrib.normals[3 * index.normal_index + 2
-						]
-					};
+					chunk.remap[i] = uniqueVertices.insert(chunk.vertices[i]);
 				}
+				chunk.vertices = {};
+			}
 
-				if (index.texcoord_index >= 0) {
-					vertex.uv = {
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						1.0f - attrib.texcoords[2 * index.texcoord_index + 1],
-					};
-				}
+			threadPool.parallelFor(chunkCount, [&](uint32_t chunkIndex) {
+				const size_t begin = indexCount * chunkIndex / chunkCount;
+				const size_t end = indexCount * (chunkIndex + 1) / chunkCount;
 
-				if (uniqueVertices.count(vertex) == 0)
+				const auto& remap = chunks[chunkIndex].remap;
+				for (size_t i = begin; i < end; ++i)
 				{
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
+					indices[i] = remap[indices[i]];
 				}
-				indices.push_back(uniqueVertices[vertex]);
-			}
+			});
 		}
+
+		if (optimizeMesh)
+			optimize();
 	}
 
-	void LvModel::createVertexBuffers(const std::vector<Vertex>& vertices)
+	void LvModel::Builder::optimize()
 	{
-		vertexCount = static_cast<uint32_t>(vertices.size());
+		if (indices.empty())
+			return;
 
-		assert(vertexCount >= 3 && "vertex count should be at least 3");
+		const auto before = LvMeshOptimizer::analyzeVertexCache(
+			indices, vertices.size());
+		LvMeshOptimizer::OverdrawStats overdrawBefore{};
+		LvMeshOptimizer::OverdrawStats overdrawAfter{};
+		if (optimizeOverdraw)
+			overdrawBefore = LvMeshOptimizer::analyzeOverdraw(indices, vertices);
+
+		std::vector<uint32_t> clusterStarts;
+		LvMeshOptimizer::optimizeVertexCache(
+			indices, vertices.size(), clusterStarts);
+		if (optimizeOverdraw)
+		{
+			// the sort is a heuristic, inward facing meshes such as rooms
+			// can end up worse than the cache order
+			std::vector<uint32_t> sortedIndices = indices;
+			LvMeshOptimizer::optimizeOverdraw(
+				sortedIndices, vertices, clusterStarts);
+
+			overdrawAfter = LvMeshOptimizer::analyzeOverdraw(indices, vertices);
+			const auto sortedOverdraw =
+				LvMeshOptimizer::analyzeOverdraw(sortedIndices, vertices);
+			if (sortedOverdraw.overdraw < overdrawAfter.overdraw)
+			{
+				indices.swap(sortedIndices);
+				overdrawAfter = sortedOverdraw;
+			}
+		}
+		LvMeshOptimizer::optimizeVertexFetch(vertices, indices);
 
-		uint32_t vertexSize = sizeof(vertices[0]);
-		VkDeviceSize bufferSize = vertexSize * vertexCount;
+		const auto after = LvMeshOptimizer::analyzeVertexCache(
+			indices, vertices.size());
 
-		LvBuffer stagingBuffer(
-			device,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		std::cout << "mesh optimized: ACMR " << before.acmr << " -> " << after.acmr
+			<< ", ATVR " << before.atvr << " -> " << after.atvr;
+		if (optimizeOverdraw)
+		{
+			std::cout << ", overdraw " << overdrawBefore.overdraw
+				<< " -> " << overdrawAfter.overdraw;
+		}
+		std::cout << " (" << clusterStarts.size() << " clusters)" << std::endl;
+	}
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)vertices.data());
-		
-		vertexBuffer = std::make_unique<LvBuffer>(
-			device,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	uint32_t LvModel::Builder::getBuildFlags() const
+	{
+		uint32_t flags = 0;
+		if (optimizeMesh) flags |= 1u << 0;
+		if (optimizeMesh && optimizeOverdraw) flags |= 1u << 1;
+		return flags;
+	}
 
+	static void copyToRange(
+		LvUploadBatch& batch,
+		const LvUploadBatch::Staging& staging,
+		const LvGeometryArena::Range& range)
+	{
+		batch.copyBuffer(
+			staging.buffer,
+			range.buffer,
+			VkDeviceSize(range.elementSize) * range.count,
+			staging.offset,
+			VkDeviceSize(range.elementSize) * range.offset);
+	}
 
-		device.copyBuffer(
-			stagingBuffer.getBuffer(), 
-			vertexBuffer->getBuffer(),
-			bufferSize);
+	void LvModel::createBuffers(
+		const Vertex* vertices,
+		uint32_t vertexCount,
+		const uint32_t* indices,
+		uint32_t indexCount,
+		LvUploadBatch* batch)
+	{
+		LvUploadBatch localBatch{ device };
+		LvUploadBatch& uploadBatch = batch != nullptr ? *batch : localBatch;
+
+		// both ranges are reserved and staged before the first copy is
+		// recorded, a throw leaves nothing of this model in the batch
+		LvUploadBatch::Staging vertexStaging{};
+		LvUploadBatch::Staging indexStaging{};
+		try
+		{
+			vertexStaging = createVertexBuffers(vertices, vertexCount, uploadBatch);
+			indexStaging = createIndexBuffers(indices, indexCount, uploadBatch);
+		}
+		catch (...)
+		{
+			auto& geometryArena = device.getGeometryArena();
+			geometryArena.freeVertices(vertexRange);
+			geometryArena.freeIndices(indexRange);
+			throw;
+		}
+
+		copyToRange(uploadBatch, vertexStaging, vertexRange);
+		if (hasIndexBuffer)
+			copyToRange(uploadBatch, indexStaging, indexRange);
+
+		if (batch == nullptr)
+			localBatch.wait();
 	}
 
-	void LvModel::createIndexBuffers(const std::vector<uint32_t>& indices)
+	LvUploadBatch::Staging LvModel::createVertexBuffers(
+		const Vertex* vertices, 
+		uint32_t vertexCount,
+		LvUploadBatch& uploadBatch)
 	{
-		indexCount = static_cast<uint32_t>(indices.size());
-		hasIndexBuffer = indexCount > 0;
+		this->vertexCount = vertexCount;
 
-		if (!hasIndexBuffer) {
-			return;
+		assert(vertexCount >= 3 && "vertex count should be at least 3");
+
+		glm::vec3 minPosition = vertices[0].position;
+		glm::vec3 maxPosition = vertices[0].position;
+		for (uint32_t i = 1; i < vertexCount; ++i)
+		{
+			minPosition = glm::min(minPosition, vertices[i].position);
+			maxPosition = glm::max(maxPosition, vertices[i].position);
 		}
+		boundsCenter = (minPosition + maxPosition) * 0.5f;
+		boundsRadius = glm::length(maxPosition - boundsCenter);
+
+		const void* vertexData = vertices;
+		uint32_t vertexSize = sizeof(Vertex);
 
-		uint32_t indexSize = sizeof(indices[0]);
-		VkDeviceSize bufferSize = indexSize * indexCount;
+		std::vector<PackedVertex> packedVertices;
+		if (vertexFormat == VertexFormat::Packed)
+		{
+			packedVertices = packVertices(
+				vertices, vertexCount, positionTransform);
+			vertexData = packedVertices.data();
+			vertexSize = sizeof(PackedVertex);
+		}
 
-		LvBuffer stagingBuffer(
-			device,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		vertexRange = device.getGeometryArena().allocateVertices(
+			vertexSize, vertexCount);
+		return uploadBatch.stage(vertexData, VkDeviceSize(vertexSize) * vertexCount);
+	}
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*) indices.data());
+	LvUploadBatch::Staging LvModel::createIndexBuffers(
+		const uint32_t* indices, 
+		uint32_t indexCount,
+		LvUploadBatch& uploadBatch)
+	{
+		this->indexCount = indexCount;
+		hasIndexBuffer = indexCount > 0;
 
-		indexBuffer = std::make_unique<LvBuffer>(
-			device,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (!hasIndexBuffer) {
+			return {};
+		}
 
+		const void* indexData = indices;
+		indexType = VK_INDEX_TYPE_UINT32;
 
-		device.copyBuffer(
-			stagingBuffer.getBuffer(), 
-			indexBuffer->getBuffer(), 
-			bufferSize);
+		// vertex buffers are created first, so vertexCount is known here
+		std::vector<uint16_t> shortIndices;
+		if (vertexCount <= (1u << 16))
+		{
+			shortIndices.assign(indices, indices + indexCount);
+			indexData = shortIndices.data();
+			indexType = VK_INDEX_TYPE_UINT16;
+		}
 
+		indexRange = device.getGeometryArena().allocateIndices(
+			indexType, indexCount);
+		return uploadBatch.stage(
+			indexData,
+			VkDeviceSize(indexRange.elementSize) * indexCount);
 	}
 
 	void LvModel::bind(VkCommandBuffer commandBuffer)
 	{
-		VkBuffer buffers[] = {vertexBuffer->getBuffer()};
+		VkBuffer buffers[] = { vertexRange.buffer };
 		VkDeviceSize offsets[] = { 0 };
 
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
@@ -201,19 +622,33 @@ namespace lv
 		if (hasIndexBuffer) {
 			vkCmdBindIndexBuffer(
 				commandBuffer, 
-				indexBuffer->getBuffer(), 
+				indexRange.buffer, 
 				0, 
-				VK_INDEX_TYPE_UINT32);
+				indexType);
 		}
 	}
 
-	void LvModel::draw(VkCommandBuffer commandBuffer)
+	void LvModel::draw(
+		VkCommandBuffer commandBuffer,
+		uint32_t instanceCount,
+		uint32_t firstInstance)
 	{
 		if (hasIndexBuffer) {
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			vkCmdDrawIndexed(
+				commandBuffer, 
+				indexCount, 
+				instanceCount, 
+				indexRange.offset, 
+				static_cast<int32_t>(vertexRange.offset), 
+				firstInstance);
 		}
 		else {
-			vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+			vkCmdDraw(
+				commandBuffer,
+				vertexCount,
+				instanceCount,
+				vertexRange.offset,
+				firstInstance);
 		}
 	}
 
@@ -242,6 +677,41 @@ namespace lv
 		return attributeDescriptions;
 	}
 
+	std::vector<VkVertexInputBindingDescription> LvModel::PackedVertex::getBindingDescriptions()
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = sizeof(PackedVertex);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> LvModel::PackedVertex::getAttributeDescriptions()
+	{
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+		attributeDescriptions.push_back(
+			{ 0, 0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(PackedVertex, position) });
+		attributeDescriptions.push_back(
+			{ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color) });
+		attributeDescriptions.push_back(
+			{ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) });
+		attributeDescriptions.push_back(
+			{ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv) });
+
+		return attributeDescriptions;
+	}
+
+	VkDeviceSize LvModel::getVertexBufferSize() const
+	{
+		return VkDeviceSize(vertexRange.elementSize) * vertexRange.count;
+	}
+
+	VkDeviceSize LvModel::getIndexBufferSize() const
+	{
+		return VkDeviceSize(indexRange.elementSize) * indexRange.count;
+	}
+
 	std::unique_ptr<LvModel> LvModel::createCubeModel(
 		LvDevice& device,
 		glm::vec3 offset)
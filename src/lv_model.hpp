@@ -1,7 +1,9 @@
 #pragma once
 
 #include "lv_device.hpp"
-#include "lv_buffer.hpp"
+#include "lv_geometry_arena.hpp"
+#include "lv_mapped_file.hpp"
+#include "lv_upload_batch.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -31,21 +33,98 @@ namespace lv
 			}
 		};
 
+		// 20 byte alternative to Vertex, positions are quantized to the
+		// mesh bounds and expanded again by getPositionTransform()
+		struct PackedVertex
+		{
+			int16_t position[4]; // snorm16, w unused
+			uint8_t color[4];    // unorm8, a unused
+			int16_t normal[2];   // octahedral snorm16
+			uint16_t uv[2];      // half float
+
+			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+		};
+
+		enum class VertexFormat : uint32_t
+		{
+			Standard,
+			Packed
+		};
+		static constexpr uint32_t VERTEX_FORMAT_COUNT = 2;
+
 		struct Builder {
 			std::vector<Vertex> vertices{};
 			std::vector<uint32_t> indices{};
 
+			// threads used to assemble vertices, meshes below 
+			// MIN_INDICES_PER_CHUNK indices always run single threaded
+			uint32_t threadCount = 1;
+			static constexpr size_t MIN_INDICES_PER_CHUNK = 1 << 15;
+
+			// reorder indices for the post-transform cache and vertices
+			// for fetch locality once loaded, optionally also sort the
+			// triangle clusters to reduce overdraw
+			bool optimizeMesh = false;
+			bool optimizeOverdraw = false;
+
+			// layout of the vertex buffer created from this builder
+			VertexFormat vertexFormat = VertexFormat::Standard;
+
 			void loadModel(const std::string& filepath);
+			void optimize();
+
+			// options that change the built mesh, stored with cached meshes
+			uint32_t getBuildFlags() const;
+		};
+
+		// CPU side result of reading a model file, either a built mesh or
+		// the mapped mesh cache
+		struct FileData
+		{
+			Builder builder{};
+			LvMappedFile cacheFile;
+			bool isCached = false;
 		};
 
-		LvModel(LvDevice& device, const LvModel::Builder& builder);
+		// uploads are recorded into batch if given, the model must not
+		// be drawn before the batch completes
+		LvModel(
+			LvDevice& device,
+			const LvModel::Builder& builder,
+			LvUploadBatch* batch = nullptr);
+		LvModel(
+			LvDevice& device,
+			const Vertex* vertices,
+			uint32_t vertexCount,
+			const uint32_t* indices,
+			uint32_t indexCount,
+			VertexFormat vertexFormat = VertexFormat::Standard,
+			LvUploadBatch* batch = nullptr);
 		~LvModel();
 
 		LvModel(const LvModel&) = delete;
 		LvModel& operator=(const LvModel&) = delete;
 
 		void bind(VkCommandBuffer commandBuffer);
-		void draw(VkCommandBuffer commandBuffer);
+		void draw(
+			VkCommandBuffer commandBuffer,
+			uint32_t instanceCount = 1,
+			uint32_t firstInstance = 0);
+
+		VertexFormat getVertexFormat() const { return vertexFormat; }
+		// maps vertex buffer positions to model space, identity unless
+		// positions are quantized
+		const glm::mat4& getPositionTransform() const { return positionTransform; }
+		// bounding sphere in model space
+		const glm::vec3& getBoundsCenter() const { return boundsCenter; }
+		float getBoundsRadius() const { return boundsRadius; }
+		VkDeviceSize getVertexBufferSize() const;
+		VkDeviceSize getIndexBufferSize() const;
+		VkIndexType getIndexType() const { return indexType; }
+		VkBuffer getVertexBuffer() const { return vertexRange.buffer; }
+		VkBuffer getIndexBuffer() const { return indexRange.buffer; }
+		bool hasIndices() const { return hasIndexBuffer; }
 
 		static std::unique_ptr<LvModel> createCubeModel(
 			LvDevice& device, 
@@ -62,18 +141,61 @@ namespace lv
 		//	glm::vec3 offset);
 		static std::unique_ptr<LvModel> createModelFromFile(
 			LvDevice& device,
-			const std::string& filepath);
+			const std::string& filepath,
+			VertexFormat vertexFormat = VertexFormat::Standard,
+			LvUploadBatch* batch = nullptr);
+
+		// createModelFromFile split in its file work, which may run on any
+		// thread, and the device side that creates the model. threadCount
+		// is passed to Builder::threadCount, callers already running on a
+		// pool worker use 1 so each model doesn't start its own threads
+		static void loadFile(
+			const std::string& filepath,
+			VertexFormat vertexFormat,
+			uint32_t threadCount,
+			FileData& fileData);
+		static std::unique_ptr<LvModel> createModel(
+			LvDevice& device,
+			const FileData& fileData,
+			LvUploadBatch* batch = nullptr);
+
+		void printLoadInfo(
+			const std::string& filepath,
+			bool isCached,
+			float loadTime) const;
 	private:
 		LvDevice& device;
 
-		std::unique_ptr<LvBuffer> vertexBuffer;
+		VertexFormat vertexFormat;
+		glm::mat4 positionTransform{ 1.f };
+		glm::vec3 boundsCenter{ 0.f };
+		float boundsRadius = 0.f;
+
+		// vertices and indices live in the device's geometry arena
+		LvGeometryArena::Range vertexRange{};
 		uint32_t vertexCount;
 
 		bool hasIndexBuffer{ false };
-		std::unique_ptr<LvBuffer> indexBuffer;
+		LvGeometryArena::Range indexRange{};
 		uint32_t indexCount;
+		// uint16 whenever every vertex is addressable with it
+		VkIndexType indexType{ VK_INDEX_TYPE_UINT32 };
 
-		void createVertexBuffers(const std::vector<Vertex> &vertices);
-		void createIndexBuffers(const std::vector<uint32_t>& indices);
+		void createBuffers(
+			const Vertex* vertices,
+			uint32_t vertexCount,
+			const uint32_t* indices,
+			uint32_t indexCount,
+			LvUploadBatch* batch);
+		// reserve the range and stage the data, the copy is recorded by
+		// createBuffers
+		LvUploadBatch::Staging createVertexBuffers(
+			const Vertex* vertices, 
+			uint32_t vertexCount,
+			LvUploadBatch& uploadBatch);
+		LvUploadBatch::Staging createIndexBuffers(
+			const uint32_t* indices, 
+			uint32_t indexCount,
+			LvUploadBatch& uploadBatch);
 	};
 }
@@ -143,6 +143,11 @@ namespace lv
 		configInfo.depthStencilInfo.stencilTestEnable = VK_FALSE;
 		configInfo.depthStencilInfo.front = {};  // Optional
 		configInfo.depthStencilInfo.back = {};   // Optional
+
+		configInfo.bindingDescriptions = 
+			LvModel::Vertex::getBindingDescriptions();
+		configInfo.attributeDescriptions = 
+			LvModel::Vertex::getAttributeDescriptions();
 	}
 
 	void LvPipeline::createGraphicPipeline(
@@ -183,8 +188,8 @@ namespace lv
 			vertShaderStageInfo, fragShaderStageInfo 
 		};
 
-		auto bindingDescriptions = LvModel::Vertex::getBindingDescriptions();
-		auto attributeDescriptions = LvModel::Vertex::getAttributeDescriptions();
+		auto& bindingDescriptions = configInfo.bindingDescriptions;
+		auto& attributeDescriptions = configInfo.attributeDescriptions;
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vertexInputInfo.vertexAttributeDescriptionCount =
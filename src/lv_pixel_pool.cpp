@@ -0,0 +1,183 @@
+#include "lv_pixel_pool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace lv
+{
+	LvPixelPool::LvPixelPool()
+	{
+		// four classes per power of two, at most 25% of a buffer is unused
+		for (size_t base = MIN_POOLED_SIZE; base <= (size_t(1) << 31); base *= 2)
+		{
+			for (size_t quarter = 4; quarter < 8; ++quarter)
+				classCapacities.push_back(base / 4 * quarter);
+		}
+		freeBlocks.resize(classCapacities.size());
+	}
+
+	LvPixelPool::~LvPixelPool()
+	{
+		releaseAll();
+	}
+
+	LvPixelPool& LvPixelPool::instance()
+	{
+		static LvPixelPool pool;
+		return pool;
+	}
+
+	uint32_t LvPixelPool::findSizeClass(size_t size) const
+	{
+		if (size < MIN_POOLED_SIZE)
+			return UNPOOLED;
+
+		auto it = std::lower_bound(classCapacities.begin(), classCapacities.end(), size);
+		if (it == classCapacities.end())
+			return UNPOOLED;
+		return static_cast<uint32_t>(it - classCapacities.begin());
+	}
+
+	void* LvPixelPool::allocate(size_t size)
+	{
+		auto& pool = instance();
+		const uint32_t sizeClass = pool.findSizeClass(size);
+
+		Header* header = nullptr;
+		size_t capacity = size;
+		if (sizeClass != UNPOOLED)
+		{
+			capacity = pool.classCapacities[sizeClass];
+
+			std::lock_guard<std::mutex> lock(pool.poolMutex);
+			pool.stats.allocationCount += 1;
+			auto& blocks = pool.freeBlocks[sizeClass];
+			if (!blocks.empty())
+			{
+				header = blocks.back();
+				blocks.pop_back();
+				pool.stats.reuseCount += 1;
+				pool.stats.retainedBytes -= capacity;
+			}
+			pool.stats.liveBytes += capacity;
+			pool.stats.peakLiveBytes = std::max(pool.stats.peakLiveBytes, pool.stats.liveBytes);
+		}
+
+		if (header == nullptr)
+		{
+			header = static_cast<Header*>(std::malloc(sizeof(Header) + capacity));
+			if (header == nullptr)
+			{
+				if (sizeClass != UNPOOLED)
+				{
+					std::lock_guard<std::mutex> lock(pool.poolMutex);
+					pool.stats.liveBytes -= capacity;
+				}
+				return nullptr;
+			}
+			header->sizeClass = sizeClass;
+			header->capacity = capacity;
+		}
+		return header + 1;
+	}
+
+	void* LvPixelPool::reallocate(void* data, size_t size)
+	{
+		if (data == nullptr)
+			return allocate(size);
+
+		Header* header = static_cast<Header*>(data) - 1;
+		if (size <= header->capacity)
+			return data;
+
+		// small buffers growing into small buffers stay with malloc
+		auto& pool = instance();
+		if (header->sizeClass == UNPOOLED && pool.findSizeClass(size) == UNPOOLED)
+		{
+			Header* grown = static_cast<Header*>(
+				std::realloc(header, sizeof(Header) + size));
+			if (grown == nullptr)
+				return nullptr;
+			grown->capacity = size;
+			return grown + 1;
+		}
+
+		void* grown = allocate(size);
+		if (grown == nullptr)
+			return nullptr;
+		std::memcpy(grown, data, header->capacity);
+		free(data);
+		return grown;
+	}
+
+	void LvPixelPool::free(void* data)
+	{
+		if (data == nullptr)
+			return;
+
+		Header* header = static_cast<Header*>(data) - 1;
+		if (header->sizeClass == UNPOOLED)
+		{
+			std::free(header);
+			return;
+		}
+
+		auto& pool = instance();
+		{
+			std::lock_guard<std::mutex> lock(pool.poolMutex);
+			pool.stats.liveBytes -= header->capacity;
+			if (pool.stats.retainedBytes + header->capacity <= pool.retainLimit)
+			{
+				pool.freeBlocks[header->sizeClass].push_back(header);
+				pool.stats.retainedBytes += header->capacity;
+				return;
+			}
+		}
+		std::free(header);
+	}
+
+	void LvPixelPool::setRetainLimit(size_t bytes)
+	{
+		auto& pool = instance();
+		std::lock_guard<std::mutex> lock(pool.poolMutex);
+		pool.retainLimit = bytes;
+	}
+
+	void LvPixelPool::trim()
+	{
+		auto& pool = instance();
+		std::lock_guard<std::mutex> lock(pool.poolMutex);
+		pool.releaseAll();
+	}
+
+	void LvPixelPool::releaseAll()
+	{
+		for (auto& blocks : freeBlocks)
+		{
+			for (Header* header : blocks)
+				std::free(header);
+			blocks.clear();
+		}
+		stats.retainedBytes = 0;
+	}
+
+	LvPixelPool::Stats LvPixelPool::getStats()
+	{
+		auto& pool = instance();
+		std::lock_guard<std::mutex> lock(pool.poolMutex);
+		return pool.stats;
+	}
+
+	void LvPixelPool::printStats()
+	{
+		const auto stats = getStats();
+		const float MiB = 1024.f * 1024.f;
+		std::cout << "pixel pool: " << stats.allocationCount << " allocations, "
+			<< stats.reuseCount << " reused, "
+			<< stats.liveBytes / MiB << " MiB live (peak "
+			<< stats.peakLiveBytes / MiB << " MiB), "
+			<< stats.retainedBytes / MiB << " MiB retained" << std::endl;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace lv
+{
+	// Recycles the large buffers image decoding allocates. stb_image is
+	// routed through it (see lv_texture.cpp), so decoded pixels and the
+	// decoders' scratch buffers return here on stbi_image_free and the
+	// next decode of a similar size reuses them instead of faulting in
+	// fresh pages. Safe to use from any thread.
+	class LvPixelPool
+	{
+	public:
+		// smaller requests go straight to malloc
+		static constexpr size_t MIN_POOLED_SIZE = 64 * 1024;
+		static constexpr size_t DEFAULT_RETAIN_LIMIT = 128ull << 20;
+
+		struct Stats
+		{
+			uint64_t allocationCount = 0; // pooled sizes only
+			uint64_t reuseCount = 0;
+			size_t retainedBytes = 0;     // free, kept for reuse
+			size_t liveBytes = 0;         // handed out
+			size_t peakLiveBytes = 0;
+		};
+
+		static void* allocate(size_t size);
+		static void* reallocate(void* data, size_t size);
+		static void free(void* data);
+
+		// retained buffers beyond the limit are released on free
+		static void setRetainLimit(size_t bytes);
+		// releases every retained buffer
+		static void trim();
+
+		static Stats getStats();
+		static void printStats();
+
+	private:
+		struct alignas(16) Header
+		{
+			uint32_t sizeClass;
+			size_t capacity;
+		};
+		static constexpr uint32_t UNPOOLED = UINT32_MAX;
+
+		std::vector<size_t> classCapacities;
+		std::vector<std::vector<Header*>> freeBlocks;
+		size_t retainLimit = DEFAULT_RETAIN_LIMIT;
+		Stats stats{};
+		std::mutex poolMutex;
+
+		LvPixelPool();
+		~LvPixelPool();
+
+		static LvPixelPool& instance();
+		uint32_t findSizeClass(size_t size) const;
+		void releaseAll();
+	};
+}
@@ -0,0 +1,84 @@
+#include "lv_range_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace lv
+{
+	LvRangeAllocator::LvRangeAllocator(uint64_t size)
+		: size{size}
+	{
+		if (size > 0)
+			freeRanges.emplace(0, size);
+	}
+
+	uint64_t LvRangeAllocator::allocate(uint64_t size, uint64_t alignment)
+	{
+		assert(alignment > 0 && "alignment must be at least 1");
+		if (size == 0)
+			return INVALID_OFFSET;
+
+		for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+		{
+			const uint64_t rangeOffset = it->first;
+			const uint64_t rangeEnd = it->first + it->second;
+			const uint64_t offset =
+				(rangeOffset + alignment - 1) / alignment * alignment;
+			if (offset + size > rangeEnd) continue;
+
+			// the alignment gap and the tail stay free
+			freeRanges.erase(it);
+			if (offset > rangeOffset)
+				freeRanges.emplace(rangeOffset, offset - rangeOffset);
+			if (offset + size < rangeEnd)
+				freeRanges.emplace(offset + size, rangeEnd - offset - size);
+
+			usedSize += size;
+			return offset;
+		}
+		return INVALID_OFFSET;
+	}
+
+	void LvRangeAllocator::free(uint64_t offset, uint64_t size)
+	{
+		if (size == 0)
+			return;
+		assert(offset + size <= this->size && "range is out of bounds");
+
+		uint64_t begin = offset;
+		uint64_t end = offset + size;
+
+		auto next = freeRanges.lower_bound(begin);
+		assert((next == freeRanges.end() || next->first >= end)
+			&& "range overlaps a free range");
+
+		if (next != freeRanges.end() && next->first == end)
+		{
+			end += next->second;
+			next = freeRanges.erase(next);
+		}
+		if (next != freeRanges.begin())
+		{
+			auto previous = std::prev(next);
+			assert(previous->first + previous->second <= begin
+				&& "range overlaps a free range");
+			if (previous->first + previous->second == begin)
+			{
+				begin = previous->first;
+				freeRanges.erase(previous);
+			}
+		}
+
+		freeRanges.emplace(begin, end - begin);
+		usedSize -= size;
+	}
+
+	uint64_t LvRangeAllocator::getLargestFreeRange() const
+	{
+		uint64_t largest = 0;
+		for (const auto& range : freeRanges)
+			largest = std::max(largest, range.second);
+		return largest;
+	}
+}
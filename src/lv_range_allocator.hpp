@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+namespace lv
+{
+	// Free list suballocator for a linear range [0, size), the units are
+	// up to the caller (bytes, vertices, indices). Adjacent free ranges
+	// are merged when freed.
+	class LvRangeAllocator
+	{
+	public:
+		static constexpr uint64_t INVALID_OFFSET = UINT64_MAX;
+
+	private:
+		uint64_t size;
+		uint64_t usedSize{ 0 };
+		std::map<uint64_t, uint64_t> freeRanges; // offset -> size
+
+	public:
+		explicit LvRangeAllocator(uint64_t size);
+
+		// first fit, INVALID_OFFSET if no free range is large enough
+		uint64_t allocate(uint64_t size, uint64_t alignment = 1);
+		void free(uint64_t offset, uint64_t size);
+
+		uint64_t getSize() const { return size; }
+		uint64_t getUsedSize() const { return usedSize; }
+		uint64_t getLargestFreeRange() const;
+		size_t getFreeRangeCount() const { return freeRanges.size(); }
+		bool isEmpty() const { return usedSize == 0; }
+	};
+}
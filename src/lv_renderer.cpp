@@ -1,4 +1,5 @@
 #include "lv_renderer.hpp"
+#include "lv_geometry_arena.hpp"
 
 
 #include <array>
@@ -96,6 +97,9 @@ namespace lv
 			throw std::runtime_error("failed to acquire swap chain image!");
 		}
 
+		// acquireNextImage waited on this frame slot's fence
+		lvDevice.getGeometryArena().releaseRetired();
+
 		isFrameStarted = true;
 		auto commandBuffer = getCurrentCommandBuffer();
 		VkCommandBufferBeginInfo beginInfo{};
@@ -4,7 +4,7 @@
 #include "lv_device.hpp"
 #include "lv_pipeline.hpp"
 #include "lv_swapchain.hpp"
-#include "lv_game_object.hpp"
+#include "lv_scene.hpp"
 
 #include <memory>
 #include <vector>
@@ -55,6 +55,9 @@ namespace lv
 			return static_cast<float>(extent.width) / 
 				static_cast<float>(extent.height);
 		}
+		VkExtent2D getSwapChainExtent() const {
+			return lvSwapChain->getSwapChainExtent();
+		}
 
 	private:
 		void recreateSwapChain();
@@ -0,0 +1,102 @@
+#include "lv_sampler_cache.hpp"
+#include "lv_utils.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lv
+{
+	bool LvSamplerCache::Description::operator==(const Description& other) const
+	{
+		return magFilter == other.magFilter
+			&& minFilter == other.minFilter
+			&& mipmapMode == other.mipmapMode
+			&& addressMode == other.addressMode
+			&& maxAnisotropy == other.maxAnisotropy
+			&& minLod == other.minLod
+			&& maxLod == other.maxLod
+			&& borderColor == other.borderColor;
+	}
+
+	size_t LvSamplerCache::DescriptionHash::operator()(const Description& description) const
+	{
+		size_t seed = 0;
+		hashCombine(
+			seed,
+			static_cast<int>(description.magFilter),
+			static_cast<int>(description.minFilter),
+			static_cast<int>(description.mipmapMode),
+			static_cast<int>(description.addressMode),
+			description.maxAnisotropy,
+			description.minLod,
+			description.maxLod,
+			static_cast<int>(description.borderColor));
+		return seed;
+	}
+
+	LvSamplerCache::LvSamplerCache(LvDevice& device)
+		: device{device}
+	{
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(device.getPhysicalDevice(), &properties);
+
+		maxSupportedAnisotropy = properties.limits.maxSamplerAnisotropy;
+		maxSamplerCount = properties.limits.maxSamplerAllocationCount;
+	}
+
+	LvSamplerCache::~LvSamplerCache()
+	{
+		for (const auto& kv : samplers)
+			vkDestroySampler(device.getLogicalDevice(), kv.second, nullptr);
+	}
+
+	VkSampler LvSamplerCache::getSampler(const Description& description)
+	{
+		std::lock_guard<std::mutex> lock(samplerMutex);
+
+		auto it = samplers.find(description);
+		if (it != samplers.end())
+			return it->second;
+
+		if (samplers.size() >= maxSamplerCount)
+		{
+			throw std::runtime_error("maxSamplerAllocationCount exceeded");
+		}
+
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = description.magFilter;
+		samplerInfo.minFilter = description.minFilter;
+		samplerInfo.addressModeU = description.addressMode;
+		samplerInfo.addressModeV = description.addressMode;
+		samplerInfo.addressModeW = description.addressMode;
+		samplerInfo.anisotropyEnable = description.maxAnisotropy > 0.f ? VK_TRUE : VK_FALSE;
+		samplerInfo.maxAnisotropy = std::min(description.maxAnisotropy, maxSupportedAnisotropy);
+		samplerInfo.borderColor = description.borderColor;
+		samplerInfo.unnormalizedCoordinates = VK_FALSE;
+		samplerInfo.compareEnable = VK_FALSE;
+		samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+		samplerInfo.mipmapMode = description.mipmapMode;
+		samplerInfo.mipLodBias = 0.f;
+		samplerInfo.minLod = description.minLod;
+		samplerInfo.maxLod = description.maxLod;
+
+		VkSampler sampler;
+		if (vkCreateSampler(
+			device.getLogicalDevice(),
+			&samplerInfo,
+			nullptr,
+			&sampler) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture sampler");
+		}
+
+		samplers.emplace(description, sampler);
+		return sampler;
+	}
+
+	size_t LvSamplerCache::getSamplerCount()
+	{
+		std::lock_guard<std::mutex> lock(samplerMutex);
+		return samplers.size();
+	}
+}
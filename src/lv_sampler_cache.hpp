@@ -0,0 +1,59 @@
+#pragma once
+
+#include "lv_device.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <unordered_map>
+
+namespace lv
+{
+	// Hands out one VkSampler per distinct description. Samplers live
+	// until the device is destroyed, so the handles can be shared freely
+	// and never count against maxSamplerAllocationCount more than once.
+	class LvSamplerCache
+	{
+	public:
+		struct Description
+		{
+			VkFilter magFilter = VK_FILTER_LINEAR;
+			VkFilter minFilter = VK_FILTER_LINEAR;
+			VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+			VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			// clamped to the device limit, 0 disables anisotropic filtering
+			float maxAnisotropy = 0.f;
+			float minLod = 0.f;
+			// the image view already limits the levels, so textures with
+			// different mip counts can share a sampler
+			float maxLod = VK_LOD_CLAMP_NONE;
+			VkBorderColor borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+			bool operator==(const Description& other) const;
+		};
+
+	private:
+		struct DescriptionHash
+		{
+			size_t operator()(const Description& description) const;
+		};
+
+		LvDevice& device;
+		float maxSupportedAnisotropy;
+		uint32_t maxSamplerCount;
+
+		std::unordered_map<Description, VkSampler, DescriptionHash> samplers;
+		std::mutex samplerMutex;
+
+	public:
+		LvSamplerCache(LvDevice& device);
+		~LvSamplerCache();
+
+		LvSamplerCache(const LvSamplerCache&) = delete;
+		LvSamplerCache& operator=(const LvSamplerCache&) = delete;
+
+		VkSampler getSampler(const Description& description);
+
+		size_t getSamplerCount();
+	};
+}
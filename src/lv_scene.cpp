@@ -0,0 +1,290 @@
+#include "lv_scene.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lv
+{
+	// Matrix corrsponds to Translate * Ry * Rx * Rz * Scale
+	// Rotations correspond to Tait-bryan angles of Y(1), X(2), Z(3)
+	// https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
+	glm::mat4 TransformComponent::mat4() const {
+		const float c3 = glm::cos(rotation.z);
+		const float s3 = glm::sin(rotation.z);
+		const float c2 = glm::cos(rotation.x);
+		const float s2 = glm::sin(rotation.x);
+		const float c1 = glm::cos(rotation.y);
+		const float s1 = glm::sin(rotation.y);
+		return glm::mat4{
+			{
+				scale.x * (c1 * c3 + s1 * s2 * s3),
+				scale.x * (c2 * s3),
+				scale.x * (c1 * s2 * s3 - c3 * s1),
+				0.0f,
+			},
+			{
+				scale.y * (c3 * s1 * s2 - c1 * s3),
+				scale.y * (c2 * c3),
+				scale.y * (c1 * c3 * s2 + s1 * s3),
+				0.0f,
+			},
+			{
+				scale.z * (c2 * s1),
+				scale.z * (-s2),
+				scale.z * (c1 * c2),
+				0.0f,
+			},
+			{translation.x, translation.y, translation.z, 1.0f} };
+	}
+
+	glm::mat4 TransformComponent::normalMat4() const {
+		const float c3 = glm::cos(rotation.z);
+		const float s3 = glm::sin(rotation.z);
+		const float c2 = glm::cos(rotation.x);
+		const float s2 = glm::sin(rotation.x);
+		const float c1 = glm::cos(rotation.y);
+		const float s1 = glm::sin(rotation.y);
+
+		const glm::vec3 inverseScale = 1.0f / scale;
+
+		return glm::mat4{
+			{
+				inverseScale.x * (c1 * c3 + s1 * s2 * s3),
+				inverseScale.x * (c2 * s3),
+				inverseScale.x * (c1 * s2 * s3 - c3 * s1),
+				0.0f,
+			},
+			{
+				inverseScale.y * (c3 * s1 * s2 - c1 * s3),
+				inverseScale.y * (c2 * c3),
+				inverseScale.y * (c1 * c3 * s2 + s1 * s3),
+				0.0f,
+			},
+			{
+				inverseScale.z * (c2 * s1),
+				inverseScale.z * (-s2),
+				inverseScale.z * (c1 * c2),
+				0.0f,
+			},
+			{0.f, 0.f, 0.f, 0.f} };
+	}
+
+	LvScene::id_t LvScene::createEntity(
+		const TransformComponent& transform,
+		id_t parent)
+	{
+		id_t id;
+		if (!freeIds.empty())
+		{
+			id = freeIds.back();
+			freeIds.pop_back();
+		}
+		else
+		{
+			id = nextId++;
+		}
+
+		// a new root at the end of the pool keeps the order valid
+		auto& added = transforms.add(id, transform);
+		added.parent = TransformComponent::NO_PARENT;
+		added.subtreeSize = 1;
+		added.isDirty = true;
+		dirtyIds.push_back(id);
+
+		if (parent != INVALID_ID)
+			setParent(id, parent);
+		return id;
+	}
+
+	LvScene::id_t LvScene::createPointLight(
+		float intensity,
+		float radius,
+		glm::vec3 color)
+	{
+		const id_t id = createEntity();
+		auto& pointLight = pointLights.add(id);
+		pointLight.lightIntensity = intensity;
+		pointLight.radius = radius;
+		pointLight.color = color;
+
+		return id;
+	}
+
+	void LvScene::destroyEntity(id_t id)
+	{
+		if (!isAlive(id))
+			return;
+
+		// the subtree is only contiguous in a sorted pool
+		if (isOrderDirty)
+			sortTransforms();
+
+		const uint32_t first = transforms.indexOf(id);
+		const uint32_t subtreeSize = transforms.getComponents()[first].subtreeSize;
+		const std::vector<id_t> subtree(
+			transforms.getIds().begin() + first,
+			transforms.getIds().begin() + first + subtreeSize);
+
+		for (const id_t destroyed : subtree)
+		{
+			transforms.remove(destroyed);
+			renderables.remove(destroyed);
+			pointLights.remove(destroyed);
+			freeIds.push_back(destroyed);
+		}
+		isOrderDirty = true;
+	}
+
+	void LvScene::setParent(id_t id, id_t parent)
+	{
+		for (id_t ancestor = parent; ancestor != INVALID_ID; ancestor = getParent(ancestor))
+		{
+			if (ancestor == id)
+				throw std::runtime_error("entity cannot be parented to itself or its descendant");
+		}
+
+		editTransform(id).parent = parent;
+		isOrderDirty = true;
+	}
+
+	TransformComponent& LvScene::editTransform(id_t id)
+	{
+		auto& transform = transforms.get(id);
+		if (!transform.isDirty)
+		{
+			transform.isDirty = true;
+			dirtyIds.push_back(id);
+		}
+		return transform;
+	}
+
+	void LvScene::updateTransforms()
+	{
+		if (isOrderDirty)
+			sortTransforms();
+
+		auto& components = transforms.getComponents();
+		const auto& ids = transforms.getIds();
+
+		dirtyIndices.clear();
+		for (const id_t id : dirtyIds)
+		{
+			// destroyed since, or queued again after the id was reused
+			auto* transform = transforms.find(id);
+			if (transform == nullptr || !transform->isDirty)
+				continue;
+
+			transform->isDirty = false;
+			dirtyIndices.push_back(transforms.indexOf(id));
+		}
+		dirtyIds.clear();
+		std::sort(dirtyIndices.begin(), dirtyIndices.end());
+
+		// every dirty subtree once, those nested in another are skipped
+		updatedIds.clear();
+		uint32_t subtreeEnd = 0;
+		for (const uint32_t index : dirtyIndices)
+		{
+			if (index < subtreeEnd)
+				continue;
+			subtreeEnd = index + components[index].subtreeSize;
+			updatedIds.insert(updatedIds.end(), ids.begin() + index, ids.begin() + subtreeEnd);
+		}
+
+		// local matrices go through the batch kernel, the parents are
+		// applied in pool order so they are final before their children
+		const size_t count = updatedIds.size();
+		batchTransforms.resize(count);
+		batchWorldMatrices.resize(count);
+		batchNormalMatrices.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			const auto& transform = transforms.get(updatedIds[i]);
+			batchTransforms.set(
+				i, transform.translation, transform.rotation, transform.scale);
+		}
+
+		LvTransformBatch::compute(
+			batchTransforms,
+			batchWorldMatrices.data(),
+			batchNormalMatrices.data());
+
+		for (size_t i = 0; i < count; i++)
+		{
+			auto& transform = transforms.get(updatedIds[i]);
+			if (transform.parent == TransformComponent::NO_PARENT)
+			{
+				transform.worldMatrix = batchWorldMatrices[i];
+				transform.normalMatrix = batchNormalMatrices[i];
+				continue;
+			}
+
+			// the inverse transpose of a product is the product of the
+			// inverse transposes
+			const auto& parent = transforms.get(transform.parent);
+			transform.worldMatrix = parent.worldMatrix * batchWorldMatrices[i];
+			transform.normalMatrix = parent.normalMatrix * batchNormalMatrices[i];
+		}
+	}
+
+	void LvScene::sortTransforms()
+	{
+		const auto& ids = transforms.getIds();
+		auto& components = transforms.getComponents();
+		const uint32_t count = static_cast<uint32_t>(ids.size());
+
+		// children of each pool slot, grouped by parent
+		std::vector<uint32_t> childStart(count + 1, 0);
+		for (const auto& transform : components)
+		{
+			if (transform.parent != TransformComponent::NO_PARENT)
+				childStart[transforms.indexOf(transform.parent) + 1]++;
+		}
+		for (uint32_t i = 0; i < count; i++)
+			childStart[i + 1] += childStart[i];
+
+		std::vector<uint32_t> children(childStart[count]);
+		std::vector<uint32_t> childEnd(childStart.begin(), childStart.end() - 1);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const uint32_t parent = components[i].parent;
+			if (parent != TransformComponent::NO_PARENT)
+				children[childEnd[transforms.indexOf(parent)]++] = i;
+		}
+
+		// depth first from every root, siblings keep their relative order
+		std::vector<id_t> order;
+		order.reserve(count);
+		std::vector<uint32_t> stack;
+		for (uint32_t root = 0; root < count; root++)
+		{
+			if (components[root].parent != TransformComponent::NO_PARENT)
+				continue;
+
+			stack.push_back(root);
+			while (!stack.empty())
+			{
+				const uint32_t index = stack.back();
+				stack.pop_back();
+				order.push_back(ids[index]);
+				for (uint32_t child = childStart[index + 1]; child-- > childStart[index];)
+					stack.push_back(children[child]);
+			}
+		}
+
+		transforms.reorder(order);
+
+		// children follow their parents, so walking backwards has every
+		// subtree complete before it is added to its parent
+		for (auto& transform : components)
+			transform.subtreeSize = 1;
+		for (uint32_t i = count; i-- > 0;)
+		{
+			const uint32_t parent = components[i].parent;
+			if (parent != TransformComponent::NO_PARENT)
+				components[transforms.indexOf(parent)].subtreeSize += components[i].subtreeSize;
+		}
+
+		isOrderDirty = false;
+	}
+}
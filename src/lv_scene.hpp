@@ -0,0 +1,132 @@
+#pragma once
+
+#include "lv_model.hpp"
+#include "lv_texture.hpp"
+#include "lv_component_pool.hpp"
+#include "lv_transform_batch.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lv
+{
+	struct TransformComponent
+	{
+		static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+		// relative to the parent
+		glm::vec3 translation{};
+		glm::vec3 scale{1.f, 1.f, 1.f};
+		glm::vec3 rotation{};
+
+		// parent's matrices times mat4() and normalMat4(), only refreshed
+		// by LvScene::updateTransforms for transforms changed through
+		// LvScene::editTransform and their descendants
+		glm::mat4 worldMatrix{ 1.f };
+		glm::mat4 normalMatrix{ 1.f };
+		bool isDirty = false;
+
+		// set through LvScene::setParent
+		uint32_t parent = NO_PARENT;
+		// this transform and its descendants, which directly follow it
+		// in the pool while the scene's order is up to date
+		uint32_t subtreeSize = 1;
+
+		glm::mat4 mat4() const;
+		glm::mat4 normalMat4() const;
+	};
+
+	struct RenderComponent
+	{
+		std::shared_ptr<LvModel> model{};
+		// untextured objects use their vertex colors
+		std::shared_ptr<LvTexture> texture{};
+	};
+
+	struct PointLightComponent
+	{
+		float lightIntensity = 1.0f;
+		float radius = 0.1f;
+		glm::vec3 color{ 1.f };
+	};
+
+	// Entities are plain ids, every component type lives in its own
+	// LvComponentPool so a system only walks the components it needs.
+	// Each entity has a transform, the others are optional. Ids of
+	// destroyed entities are reused, which keeps the sparse arrays
+	// small.
+	//
+	// Transforms are read only through the pool. Changes go through
+	// editTransform, which queues the entity, and updateTransforms
+	// recomputes the cached matrices of the queued ones once per frame,
+	// so static objects cost nothing.
+	//
+	// Entities can be parented to others. The transform pool is kept in
+	// depth first order, parents before their children and every
+	// subtree in one contiguous range, so a changed transform refreshes
+	// its descendants in a single linear pass. Only structural changes
+	// (setParent, destroyEntity) sort the pool again, on the next
+	// updateTransforms.
+	class LvScene
+	{
+	public:
+		using id_t = uint32_t;
+		static constexpr id_t INVALID_ID = TransformComponent::NO_PARENT;
+
+	private:
+		LvComponentPool<TransformComponent> transforms;
+		LvComponentPool<RenderComponent> renderables;
+		LvComponentPool<PointLightComponent> pointLights;
+
+		id_t nextId = 0;
+		std::vector<id_t> freeIds;
+
+		std::vector<id_t> dirtyIds;
+		std::vector<id_t> updatedIds;
+		std::vector<uint32_t> dirtyIndices;
+		bool isOrderDirty = false;
+
+		// scratch for updateTransforms
+		LvTransformBatch::Arrays batchTransforms;
+		std::vector<glm::mat4> batchWorldMatrices;
+		std::vector<glm::mat4> batchNormalMatrices;
+
+	public:
+		LvScene() = default;
+
+		LvScene(const LvScene&) = delete;
+		LvScene& operator=(const LvScene&) = delete;
+
+		id_t createEntity(
+			const TransformComponent& transform = {},
+			id_t parent = INVALID_ID);
+		id_t createPointLight(
+			float intensity = 10.f,
+			float radius = 0.1f,
+			glm::vec3 color = glm::vec3(1.f));
+		// destroys the entity's descendants as well
+		void destroyEntity(id_t id);
+		// INVALID_ID detaches, the local transform is kept either way
+		void setParent(id_t id, id_t parent);
+		id_t getParent(id_t id) const { return transforms.get(id).parent; }
+		bool isAlive(id_t id) const { return transforms.has(id); }
+		size_t getEntityCount() const { return transforms.size(); }
+
+		// marks the transform for the next updateTransforms
+		TransformComponent& editTransform(id_t id);
+		// call once per frame before the matrices are read, edits made
+		// after it show up the next frame
+		void updateTransforms();
+		// entities whose matrices the last updateTransforms changed, in
+		// pool order
+		const std::vector<id_t>& getUpdatedTransforms() const { return updatedIds; }
+
+		const LvComponentPool<TransformComponent>& getTransforms() const { return transforms; }
+		LvComponentPool<RenderComponent>& getRenderables() { return renderables; }
+		LvComponentPool<PointLightComponent>& getPointLights() { return pointLights; }
+
+	private:
+		void sortTransforms();
+	};
+}
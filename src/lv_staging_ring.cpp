@@ -0,0 +1,228 @@
+#include "lv_staging_ring.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace lv
+{
+	static uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	LvStagingRing::LvStagingRing(LvDevice& device, VkDeviceSize capacity)
+		: device{device}, capacity{capacity}
+	{
+		ringBuffer = std::make_unique<LvBuffer>(
+			device,
+			capacity,
+			1,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		ringBuffer->map();
+	}
+
+	LvStagingRing::~LvStagingRing()
+	{
+		VkDevice vkDevice = device.getLogicalDevice();
+
+		std::vector<VkFence> pendingFences;
+		for (const auto& entry : segments)
+		{
+			if (entry.second.fence != VK_NULL_HANDLE)
+				pendingFences.push_back(entry.second.fence);
+		}
+		if (!pendingFences.empty())
+		{
+			vkWaitForFences(
+				vkDevice,
+				static_cast<uint32_t>(pendingFences.size()),
+				pendingFences.data(),
+				VK_TRUE,
+				UINT64_MAX);
+		}
+
+		for (VkFence fence : pendingFences)
+			vkDestroyFence(vkDevice, fence, nullptr);
+		for (VkFence fence : freeFences)
+			vkDestroyFence(vkDevice, fence, nullptr);
+	}
+
+	uint64_t LvStagingRing::openSegment()
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+
+		const uint64_t segmentId = nextSegmentId++;
+		segments.emplace(segmentId, Segment{});
+		return segmentId;
+	}
+
+	LvStagingRing::Allocation LvStagingRing::allocate(
+		uint64_t segmentId,
+		VkDeviceSize size,
+		VkDeviceSize alignment)
+	{
+		assert(capacity % alignment == 0 && "alignment has to divide the ring size");
+
+		std::lock_guard<std::mutex> lock(ringMutex);
+
+		auto segment = segments.find(segmentId);
+		assert(segment != segments.end() && segment->second.fence == VK_NULL_HANDLE
+			&& "allocations need an open segment");
+
+		Allocation allocation{};
+		allocation.size = size;
+
+		while (size <= capacity)
+		{
+			uint64_t position = alignUp(head, alignment);
+			// never split an allocation over the end of the ring
+			if (position % capacity + size > capacity)
+				position = alignUp(position, capacity);
+
+			if (position + size - tail <= capacity)
+			{
+				head = position + size;
+				if (!ranges.empty() && ranges.back().segmentId == segmentId)
+					ranges.back().end = head;
+				else
+					ranges.push_back({ head, segmentId });
+
+				allocation.buffer = ringBuffer->getBuffer();
+				allocation.offset = position % capacity;
+				allocation.mapped = static_cast<char*>(ringBuffer->getMappedMemory())
+					+ allocation.offset;
+				return allocation;
+			}
+
+			if (!waitForOldest())
+				break;
+		}
+
+		// freed with its segment, so it never pins a linear block
+		auto overflowBuffer = std::make_unique<LvBuffer>(
+			device,
+			size,
+			1,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			1,
+			LvMemoryAllocator::Strategy::Linear);
+		overflowBuffer->map();
+
+		allocation.buffer = overflowBuffer->getBuffer();
+		allocation.mapped = overflowBuffer->getMappedMemory();
+		segment->second.overflowBuffers.push_back(std::move(overflowBuffer));
+		return allocation;
+	}
+
+	LvStagingRing::Submission LvStagingRing::closeSegment(uint64_t segmentId)
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+
+		reclaim();
+
+		Segment& segment = segments.at(segmentId);
+		assert(segment.fence == VK_NULL_HANDLE && "segment was already closed");
+		segment.fence = acquireFence();
+		return { segmentId, segment.fence };
+	}
+
+	void LvStagingRing::discardSegment(uint64_t segmentId)
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+
+		auto segment = segments.find(segmentId);
+		if (segment == segments.end())
+			return;
+
+		assert(segment->second.fence == VK_NULL_HANDLE && "submitted segments cannot be discarded");
+		segments.erase(segment);
+		reclaim();
+	}
+
+	bool LvStagingRing::isComplete(uint64_t segmentId)
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+
+		reclaim();
+		return segments.find(segmentId) == segments.end();
+	}
+
+	void LvStagingRing::wait(uint64_t segmentId)
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+
+		auto segment = segments.find(segmentId);
+		if (segment == segments.end())
+			return;
+
+		assert(segment->second.fence != VK_NULL_HANDLE && "segment was never submitted");
+		vkWaitForFences(
+			device.getLogicalDevice(), 1, &segment->second.fence, VK_TRUE, UINT64_MAX);
+		reclaim();
+	}
+
+	void LvStagingRing::reclaim()
+	{
+		VkDevice vkDevice = device.getLogicalDevice();
+
+		for (auto segment = segments.begin(); segment != segments.end();)
+		{
+			VkFence fence = segment->second.fence;
+			if (fence == VK_NULL_HANDLE || vkGetFenceStatus(vkDevice, fence) != VK_SUCCESS)
+			{
+				++segment;
+				continue;
+			}
+
+			vkResetFences(vkDevice, 1, &fence);
+			freeFences.push_back(fence);
+			segment = segments.erase(segment);
+		}
+
+		// ring space is only reused in order
+		while (!ranges.empty() && segments.find(ranges.front().segmentId) == segments.end())
+		{
+			tail = ranges.front().end;
+			ranges.pop_front();
+		}
+	}
+
+	bool LvStagingRing::waitForOldest()
+	{
+		reclaim();
+		if (ranges.empty())
+			return false;
+
+		// a segment that is still recording, maybe by the caller, cannot
+		// be waited on
+		VkFence fence = segments.at(ranges.front().segmentId).fence;
+		if (fence == VK_NULL_HANDLE)
+			return false;
+
+		vkWaitForFences(device.getLogicalDevice(), 1, &fence, VK_TRUE, UINT64_MAX);
+		reclaim();
+		return true;
+	}
+
+	VkFence LvStagingRing::acquireFence()
+	{
+		if (!freeFences.empty())
+		{
+			VkFence fence = freeFences.back();
+			freeFences.pop_back();
+			return fence;
+		}
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		VkFence fence;
+		if (vkCreateFence(device.getLogicalDevice(), &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create staging fence");
+		}
+		return fence;
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "lv_device.hpp"
+#include "lv_buffer.hpp"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace lv
+{
+	// Persistently mapped host visible ring that uploads are staged in.
+	// Every recorder stages into a segment of its own, which is closed by
+	// the submission that reads from it and recycled once its fence
+	// signals. Recorders may interleave their allocations, so segments
+	// complete in any order, ring space is reused once all allocations
+	// before it are recycled. Uploads that do not fit, or that would have
+	// to wait on a segment that is still recording, get a temporary
+	// buffer that lives as long as their segment.
+	class LvStagingRing
+	{
+	public:
+		static constexpr VkDeviceSize RING_SIZE = 32 * 1024 * 1024;
+		static constexpr VkDeviceSize DEFAULT_ALIGNMENT = 16;
+
+		struct Allocation
+		{
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			void* mapped = nullptr;
+		};
+
+		struct Submission
+		{
+			uint64_t segmentId;
+			VkFence fence;
+		};
+
+	private:
+		struct Segment
+		{
+			// set once the segment is closed
+			VkFence fence = VK_NULL_HANDLE;
+			std::vector<std::unique_ptr<LvBuffer>> overflowBuffers;
+		};
+
+		// ring space up to end belongs to the segment
+		struct Range
+		{
+			uint64_t end;
+			uint64_t segmentId;
+		};
+
+		LvDevice& device;
+		std::unique_ptr<LvBuffer> ringBuffer;
+		VkDeviceSize capacity;
+
+		// monotonic positions, the ring offset is position % capacity
+		uint64_t head = 0;
+		uint64_t tail = 0;
+		uint64_t nextSegmentId = 0;
+
+		// open and in flight, recycled segments are removed
+		std::unordered_map<uint64_t, Segment> segments;
+		// in allocation order
+		std::deque<Range> ranges;
+		std::vector<VkFence> freeFences;
+		std::mutex ringMutex;
+
+	public:
+		LvStagingRing(LvDevice& device, VkDeviceSize capacity = RING_SIZE);
+		~LvStagingRing();
+
+		LvStagingRing(const LvStagingRing&) = delete;
+		LvStagingRing& operator=(const LvStagingRing&) = delete;
+
+		uint64_t openSegment();
+
+		// blocks on the oldest in flight segment when the ring is full
+		Allocation allocate(
+			uint64_t segmentId,
+			VkDeviceSize size,
+			VkDeviceSize alignment = DEFAULT_ALIGNMENT);
+
+		// the returned fence has to be passed to the submission that
+		// consumes the segment's allocations
+		Submission closeSegment(uint64_t segmentId);
+		// for a segment whose allocations are never submitted
+		void discardSegment(uint64_t segmentId);
+
+		// the fence of a segment is recycled once it completes, poll and
+		// wait through the segment id instead
+		bool isComplete(uint64_t segmentId);
+		void wait(uint64_t segmentId);
+
+		VkDeviceSize getCapacity() const { return capacity; }
+		size_t getSegmentCount() const { return segments.size(); }
+
+	private:
+		void reclaim();
+		// false if the oldest allocation's segment is still recording
+		bool waitForOldest();
+		VkFence acquireFence();
+	};
+}
@@ -129,11 +129,11 @@ namespace lv
 		for (int i = 0; i < depthImages.size(); i++) {
 			vkDestroyImageView(ldevice, depthImageViews[i], nullptr);
 			vkDestroyImage(ldevice, depthImages[i], nullptr);
-			vkFreeMemory(ldevice, depthImageMemorys[i], nullptr);
+			device.getMemoryAllocator().free(depthImageAllocations[i]);
 		}
 		depthImageViews.clear();
 		depthImages.clear();
-		depthImageMemorys.clear();
+		depthImageAllocations.clear();
 
 		for (auto framebuffer : swapChainFramebuffers) {
 			vkDestroyFramebuffer(ldevice, framebuffer, nullptr);
@@ -403,7 +403,7 @@ namespace lv
 		VkExtent2D swapChainExtent = getSwapChainExtent();
 
 		depthImages.resize(getImageCount());
-		depthImageMemorys.resize(getImageCount());
+		depthImageAllocations.resize(getImageCount());
 		depthImageViews.resize(getImageCount());
 
 		for (int i = 0; i < depthImages.size(); i++) {
@@ -431,7 +431,7 @@ namespace lv
 				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
 				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 				depthImages[i],
-				depthImageMemorys[i]);
+				depthImageAllocations[i]);
 
 			VkImageViewCreateInfo viewInfo{};
 			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -1,15 +1,33 @@
 #include "lv_texture.hpp"
-#include "lv_buffer.hpp"
+#include "lv_upload_batch.hpp"
+#include "lv_texture_cache.hpp"
+#include "lv_sampler_cache.hpp"
+#include "lv_texture_table.hpp"
 
+#include "lv_pixel_pool.hpp"
+
+// decoded pixels and decoder scratch memory are recycled between loads
+#define STBI_MALLOC(size) lv::LvPixelPool::allocate(size)
+#define STBI_REALLOC(data, size) lv::LvPixelPool::reallocate(data, size)
+#define STBI_FREE(data) lv::LvPixelPool::free(data)
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
+#include <cassert>
+
 namespace lv
 {
 	void LvTexture::Builder::loadTexture(const std::string& filepath)
 	{
-		pixels = (void*)stbi_load(
-			filepath.c_str(),
+		// decoded straight from the mapping, no stdio copies
+		LvMappedFile file;
+		if (!file.open(filepath))
+			throw std::runtime_error("unable to open texture " + filepath);
+
+		pixels = (void*)stbi_load_from_memory(
+			static_cast<const stbi_uc*>(file.data()),
+			static_cast<int>(file.size()),
 			&texWidth, 
 			&texHeight, 
 			&texChannels, 
@@ -19,110 +37,444 @@ namespace lv
 			throw std::runtime_error("unable to load texture " + filepath);
 	}
 
+	void LvTexture::Builder::buildMipChain()
+	{
+		mipChain = LvImageUtils::buildMipChain(
+			static_cast<const uint8_t*>(pixels),
+			static_cast<uint32_t>(texWidth),
+			static_cast<uint32_t>(texHeight),
+			true);
+	}
+
+	void LvTexture::Builder::loadCachedTexture(
+		const std::string& filepath,
+		LvTextureCache::Format format)
+	{
+		cacheFormat = format;
+
+		uint64_t sourceHash = 0;
+		if (!LvTextureCache::hashSource(filepath, sourceHash))
+			throw std::runtime_error("unable to open texture " + filepath);
+		isCached = LvTextureCache::load(sourceHash, format, cacheFile);
+
+		if (!isCached)
+		{
+			loadTexture(filepath);
+
+			// first run or the source changed, later ones map the stored file
+			if (!LvTextureCache::store(
+				sourceHash,
+				format,
+				static_cast<const uint8_t*>(pixels),
+				static_cast<uint32_t>(texWidth),
+				static_cast<uint32_t>(texHeight)))
+				return;
+			if (!LvTextureCache::load(sourceHash, format, cacheFile))
+				return;
+
+			stbi_image_free((stbi_uc*)pixels);
+			pixels = nullptr;
+			isCached = true;
+		}
+
+		const auto level = LvTextureCache::getLevel(cacheFile, 0);
+		texWidth = static_cast<int>(level.width);
+		texHeight = static_cast<int>(level.height);
+		texChannels = 4;
+	}
+
 	void LvTexture::Builder::unloadTexture()
 	{
 		stbi_image_free((stbi_uc*)pixels);
+		pixels = nullptr;
+		mipChain = {};
+		cacheFile.close();
+		isCached = false;
+	}
+
+	uint32_t LvTexture::Builder::getLevelCount() const
+	{
+		if (isCached)
+			return LvTextureCache::getLevelCount(cacheFile);
+		return LvImageUtils::mipLevelCount(
+			static_cast<uint32_t>(texWidth),
+			static_cast<uint32_t>(texHeight));
 	}
 
-	LvTexture::LvTexture(LvDevice& device, const Builder& builder)
+	LvTextureCache::Level LvTexture::Builder::getLevel(uint32_t level) const
+	{
+		if (isCached)
+			return LvTextureCache::getLevel(cacheFile, level);
+
+		if (level == 0)
+		{
+			const uint32_t w = static_cast<uint32_t>(texWidth);
+			const uint32_t h = static_cast<uint32_t>(texHeight);
+			return { static_cast<const uint8_t*>(pixels), size_t(w) * h * 4, w, h };
+		}
+
+		if (level > mipChain.levels.size())
+			throw std::runtime_error("texture mip chain has not been built");
+
+		const auto& mip = mipChain.levels[level - 1];
+		return {
+			mipChain.data.data() + mip.offset,
+			size_t(mip.width) * mip.height * 4,
+			mip.width,
+			mip.height };
+	}
+
+	LvTexture::LvTexture(
+		LvDevice& device,
+		const Builder& builder,
+		LvUploadBatch* batch)
 		: device{device}
 	{
 		width = builder.texWidth;
 		height = builder.texHeight;
 
-		uint32_t imageSize = width * height * 4;
+		textureSampler = device.getSamplerCache().getSampler({});
+
+		LvUploadBatch localBatch{ device };
+		LvUploadBatch& uploadBatch = batch != nullptr ? *batch : localBatch;
+
+		if (builder.isCached)
+			uploadCached(builder, uploadBatch);
+		else
+			uploadPixels(builder, uploadBatch);
+
+		if (batch == nullptr)
+			localBatch.wait();
+	}
+
+	LvTexture::LvTexture(
+		LvDevice& device,
+		std::shared_ptr<const Builder> source,
+		uint32_t firstMip,
+		LvUploadBatch* batch)
+		: device{device}, streamSource{source}
+	{
+		width = source->texWidth;
+		height = source->texHeight;
+		format = source->isCached
+			? LvTextureCache::getVkFormat(source->cacheFormat)
+			: FORMAT;
+		mipLevels = source->getLevelCount();
+
+		// needed by descriptorInfo() when the residency is swapped in
+		textureSampler = device.getSamplerCache().getSampler({});
+
+		LvUploadBatch localBatch{ device };
+		LvUploadBatch& uploadBatch = batch != nullptr ? *batch : localBatch;
+
+		Residency residency{};
+		residency.firstMip = std::min(firstMip, mipLevels - 1);
+		std::vector<StagedLevel> levels;
+		try
+		{
+			levels = stageLevels(*source, residency, uploadBatch);
+			swapResidency(residency);
+		}
+		catch (...)
+		{
+			destroyResidency(device, residency);
+			throw;
+		}
+		recordLevels(uploadBatch, residency.image, mipLevels - residency.firstMip, levels);
+
+		if (batch == nullptr)
+			localBatch.wait();
+	}
+
+	void LvTexture::uploadPixels(const Builder& builder, LvUploadBatch& uploadBatch)
+	{
+		format = FORMAT;
+		mipLevels = LvImageUtils::mipLevelCount(width, height);
+
+		const bool isBlitted =
+			builder.mipChain.levels.empty() && device.isLinearBlitSupported(format);
+
+		LvImageUtils::MipChain localChain{};
+		if (builder.mipChain.levels.empty() && !isBlitted)
+		{
+			localChain = LvImageUtils::buildMipChain(
+				static_cast<const uint8_t*>(builder.pixels),
+				static_cast<uint32_t>(width),
+				static_cast<uint32_t>(height),
+				true);
+		}
+		const auto& mipChain = builder.mipChain.levels.empty()
+			? localChain : builder.mipChain;
+
+		Residency residency{};
+		std::vector<StagedLevel> levels;
+		try
+		{
+			device.createImage(
+				width,
+				height,
+				format,
+				VK_IMAGE_TILING_OPTIMAL,
+				VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				residency.image,
+				residency.allocation,
+				mipLevels);
+			residency.view = device.createImageView(residency.image, format, mipLevels);
+
+			levels.push_back({
+				uploadBatch.stage(builder.pixels, VkDeviceSize(width) * height * 4),
+				static_cast<uint32_t>(width),
+				static_cast<uint32_t>(height) });
+			for (const auto& level : mipChain.levels)
+			{
+				levels.push_back({
+					uploadBatch.stage(
+						mipChain.data.data() + level.offset,
+						VkDeviceSize(level.width) * level.height * 4),
+					level.width,
+					level.height });
+			}
+
+			swapResidency(residency);
+		}
+		catch (...)
+		{
+			destroyResidency(device, residency);
+			throw;
+		}
+
+		if (isBlitted)
+		{
+			recordLevels(uploadBatch, residency.image, mipLevels, levels, false);
+			uploadBatch.generateMipmaps(
+				residency.image,
+				static_cast<uint32_t>(width),
+				static_cast<uint32_t>(height),
+				mipLevels);
+			return;
+		}
+		recordLevels(uploadBatch, residency.image, mipLevels, levels);
+	}
+
+	void LvTexture::uploadCached(const Builder& builder, LvUploadBatch& uploadBatch)
+	{
+		format = LvTextureCache::getVkFormat(builder.cacheFormat);
+		mipLevels = LvTextureCache::getLevelCount(builder.cacheFile);
 
-		LvBuffer stagingBuffer(
-			device,
-			imageSize,
-			1,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)builder.pixels);
+		Residency residency{};
+		std::vector<StagedLevel> levels;
+		try
+		{
+			// straight from the mapped file into staging
+			levels = stageLevels(builder, residency, uploadBatch);
+			swapResidency(residency);
+		}
+		catch (...)
+		{
+			destroyResidency(device, residency);
+			throw;
+		}
+		recordLevels(uploadBatch, residency.image, mipLevels, levels);
+	}
+
+	// creates the image and view for levels residency.firstMip and below
+	// of format and stages them from the builder as they are. Nothing is
+	// recorded, the caller destroys the residency if this throws.
+	std::vector<LvTexture::StagedLevel> LvTexture::stageLevels(
+		const Builder& builder,
+		Residency& residency,
+		LvUploadBatch& uploadBatch)
+	{
+		const uint32_t levelCount = mipLevels - residency.firstMip;
+		const auto firstLevel = builder.getLevel(residency.firstMip);
 
 		device.createImage(
-			width,
-			height,
-			VK_FORMAT_R8G8B8A8_SRGB,
+			firstLevel.width,
+			firstLevel.height,
+			format,
 			VK_IMAGE_TILING_OPTIMAL,
 			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			textureImage,
-			textureImageMemory);
+			residency.image,
+			residency.allocation,
+			levelCount);
+		residency.view = device.createImageView(residency.image, format, levelCount);
 
-		device.transitionImageWithLayout(
-			textureImage,
-			VK_FORMAT_R8G8B8A8_SRGB,
+		std::vector<StagedLevel> levels;
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			const auto level = builder.getLevel(residency.firstMip + i);
+			levels.push_back({
+				uploadBatch.stage(level.data, level.size),
+				level.width,
+				level.height });
+		}
+		return levels;
+	}
+
+	// staged levels go to the image's first levels, levelCount is the
+	// whole image
+	void LvTexture::recordLevels(
+		LvUploadBatch& uploadBatch,
+		VkImage image,
+		uint32_t levelCount,
+		const std::vector<StagedLevel>& levels,
+		bool isShaderReadable)
+	{
+		uploadBatch.transitionImageLayout(
+			image,
 			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		
-		device.copyBufferToImage(
-			stagingBuffer.getBuffer(),
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			levelCount);
+
+		for (uint32_t i = 0; i < levels.size(); i++)
+		{
+			uploadBatch.copyBufferToImage(
+				levels[i].staging.buffer,
+				image,
+				levels[i].width,
+				levels[i].height,
+				levels[i].staging.offset,
+				i);
+		}
+
+		if (!isShaderReadable)
+			return;
+
+		uploadBatch.transitionImageLayout(
+			image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			levelCount);
+	}
+
+	LvTexture::~LvTexture()
+	{
+		// frames in flight may still sample the image, it goes with the slot
+		Residency residency{
 			textureImage,
+			textureImageAllocation,
+			textureImageView,
+			residentMip };
+		device.getTextureTable().remove(bindlessIndex, residency);
+	}
+
+	uint32_t LvTexture::getTailMip() const
+	{
+		return computeTailMip(
 			static_cast<uint32_t>(width),
-			static_cast<uint32_t>(height));
+			static_cast<uint32_t>(height),
+			mipLevels);
+	}
+
+	uint32_t LvTexture::computeTailMip(
+		uint32_t width,
+		uint32_t height,
+		uint32_t levelCount)
+	{
+		uint32_t mip = 0;
+		uint32_t size = std::max(width, height);
+		while (size > STREAMING_TAIL_SIZE && mip + 1 < levelCount)
+		{
+			size = std::max(size / 2, 1u);
+			++mip;
+		}
+		return mip;
+	}
+
+	VkDeviceSize LvTexture::getLevelRangeSize(uint32_t firstMip) const
+	{
+		if (streamSource == nullptr)
+			return textureImageAllocation.size;
+
+		VkDeviceSize size = 0;
+		for (uint32_t i = firstMip; i < mipLevels; i++)
+			size += streamSource->getLevel(i).size;
+		return size;
+	}
+
+	LvTexture::Residency LvTexture::createResidency(
+		uint32_t firstMip,
+		LvUploadBatch& batch)
+	{
+		assert(streamSource != nullptr && "texture is not streamed");
+		assert(firstMip < mipLevels && "first mip is out of range");
+
+		Residency residency{};
+		residency.firstMip = firstMip;
+		std::vector<StagedLevel> levels;
+		try
+		{
+			levels = stageLevels(*streamSource, residency, batch);
+		}
+		catch (...)
+		{
+			destroyResidency(device, residency);
+			throw;
+		}
+		recordLevels(batch, residency.image, mipLevels - firstMip, levels);
+		return residency;
+	}
 
-		device.transitionImageWithLayout(
+	LvTexture::Residency LvTexture::swapResidency(Residency residency)
+	{
+		Residency previous{
 			textureImage,
-			VK_FORMAT_R8G8B8A8_SRGB,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			textureImageAllocation,
+			textureImageView,
+			residentMip };
+		const uint32_t previousIndex = bindlessIndex;
 
-		textureImageView = 
-			device.createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB);
+		textureImage = residency.image;
+		textureImageAllocation = residency.allocation;
+		textureImageView = residency.view;
+		residentMip = residency.firstMip;
 
-		createTextureSampler();
+		// a fresh slot, pending frames keep reading the old one
+		bindlessIndex = device.getTextureTable().add(descriptorInfo());
+		if (previous.image != VK_NULL_HANDLE)
+			device.getTextureTable().remove(previousIndex);
+
+		return previous;
 	}
 
-	LvTexture::~LvTexture()
+	void LvTexture::destroyResidency(LvDevice& device, Residency& residency)
 	{
+		if (residency.image == VK_NULL_HANDLE)
+			return;
+
 		VkDevice vkDevice = device.getLogicalDevice();
 		
-		vkDestroySampler(vkDevice, textureSampler, nullptr);
-		vkDestroyImageView(vkDevice, textureImageView, nullptr);
-		vkDestroyImage(vkDevice, textureImage, nullptr);
-		vkFreeMemory(vkDevice, textureImageMemory, nullptr);
+		vkDestroyImageView(vkDevice, residency.view, nullptr);
+		vkDestroyImage(vkDevice, residency.image, nullptr);
+		device.getMemoryAllocator().free(residency.allocation);
+		residency = {};
 	}
 
 	std::unique_ptr<LvTexture> LvTexture::createTextureFromFile(
 		LvDevice& device,
-		const std::string& filepath)
+		const std::string& filepath,
+		LvUploadBatch* batch)
 	{
 		Builder textureBuilder{};
-		textureBuilder.loadTexture(filepath);
-
-		return std::make_unique<LvTexture>(device, textureBuilder);
-	}
-
-	void LvTexture::createTextureSampler()
-	{
-		VkPhysicalDeviceProperties properties{};
-		vkGetPhysicalDeviceProperties(
-			device.getPhysicalDevice(), &properties);
-
-		VkSamplerCreateInfo samplerInfo{};
-		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-		samplerInfo.magFilter = VK_FILTER_LINEAR;
-		samplerInfo.minFilter = VK_FILTER_LINEAR;
-		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerInfo.anisotropyEnable = VK_FALSE;
-		samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
-		samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-		samplerInfo.unnormalizedCoordinates = VK_FALSE;
-		samplerInfo.compareEnable = VK_FALSE;
-		samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-
-		if (vkCreateSampler(
-			device.getLogicalDevice(),
-			&samplerInfo, 
-			nullptr, 
-			&textureSampler) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create texture sampler");
-		}
+		loadBuilder(device, filepath, textureBuilder);
+
+		auto texture = std::make_unique<LvTexture>(device, textureBuilder, batch);
+		textureBuilder.unloadTexture();
+		return texture;
+	}
+
+	void LvTexture::loadBuilder(
+		LvDevice& device,
+		const std::string& filepath,
+		Builder& builder)
+	{
+		builder.loadCachedTexture(
+			filepath,
+			device.isTextureCompressionBCSupported()
+				? COMPRESSED_FORMAT
+				: LvTextureCache::Format::RGBA8);
 	}
 
 	VkDescriptorImageInfo LvTexture::descriptorInfo()
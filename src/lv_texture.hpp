@@ -1,39 +1,125 @@
 #pragma once
 
 #include "lv_device.hpp"
+#include "lv_image_utils.hpp"
+#include "lv_block_encoder.hpp"
+#include "lv_mapped_file.hpp"
+#include "lv_texture_cache.hpp"
+#include "lv_upload_batch.hpp"
 
 #include <vulkan/vulkan.h>
 
 #include <memory>
+#include <vector>
 
 namespace lv
 {
 	class LvTexture
 	{
 	public:
+		static constexpr VkFormat FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+		static constexpr LvTextureCache::Format COMPRESSED_FORMAT =
+			LvTextureCache::Format::BC7;
+
 		struct Builder
 		{
 			int texWidth, texHeight, texChannels;
 			void* pixels = nullptr;
+			// optional, mips are blitted on the GPU where the format allows
+			LvImageUtils::MipChain mipChain;
+
+			// set when the mip chain was mapped from LvTextureCache, the
+			// levels are uploaded as they are and pixels stays empty
+			bool isCached = false;
+			LvTextureCache::Format cacheFormat = COMPRESSED_FORMAT;
+			LvMappedFile cacheFile;
+
 			void loadTexture(const std::string& filepath);
+			// decodes and stores the cache entry on first use, falls back
+			// to loadTexture's result if it cannot be written
+			void loadCachedTexture(
+				const std::string& filepath,
+				LvTextureCache::Format format);
+			void buildMipChain();
 			void unloadTexture();
+
+			// levels of the full chain, uncompressed pixels need the mip
+			// chain built to reach anything below level 0
+			uint32_t getLevelCount() const;
+			LvTextureCache::Level getLevel(uint32_t level) const;
 		};
 
+		// image holding levels firstMip and below of a streamed texture,
+		// created and swapped in by LvTextureStreamer
+		struct Residency
+		{
+			VkImage image = VK_NULL_HANDLE;
+			LvMemoryAllocator::Allocation allocation{};
+			VkImageView view = VK_NULL_HANDLE;
+			uint32_t firstMip = 0;
+		};
+
+		// levels at most this many texels wide stay resident while streaming
+		static constexpr uint32_t STREAMING_TAIL_SIZE = 64;
+
 	private:
 		LvDevice& device;
 
 		VkImage textureImage = VK_NULL_HANDLE;
-		VkDeviceMemory textureImageMemory = VK_NULL_HANDLE;
+		LvMemoryAllocator::Allocation textureImageAllocation{};
 		VkImageView textureImageView = VK_NULL_HANDLE;
+		// owned by the device's sampler cache
 		VkSampler textureSampler = VK_NULL_HANDLE;
+		// slot in the device's texture table
+		uint32_t bindlessIndex = 0;
 
+		VkFormat format;
 		int width;
 		int height;
+		uint32_t mipLevels;
+
+		// only set for streamed textures, the image then holds levels
+		// residentMip and below
+		std::shared_ptr<const Builder> streamSource;
+		uint32_t residentMip = 0;
 
-		void createTextureSampler();
+		struct StagedLevel
+		{
+			LvUploadBatch::Staging staging;
+			uint32_t width;
+			uint32_t height;
+		};
+
+		// everything that can fail happens before the first command is
+		// recorded, a throw leaves nothing of the texture in the batch
+		void uploadPixels(const Builder& builder, LvUploadBatch& uploadBatch);
+		void uploadCached(const Builder& builder, LvUploadBatch& uploadBatch);
+		std::vector<StagedLevel> stageLevels(
+			const Builder& builder,
+			Residency& residency,
+			LvUploadBatch& uploadBatch);
+		static void recordLevels(
+			LvUploadBatch& uploadBatch,
+			VkImage image,
+			uint32_t levelCount,
+			const std::vector<StagedLevel>& levels,
+			bool isShaderReadable = true);
 
 	public:
-		LvTexture(LvDevice& device, const Builder& builder);
+		// the upload is recorded into batch if given, the texture must
+		// not be sampled before the batch completes
+		LvTexture(
+			LvDevice& device,
+			const Builder& builder,
+			LvUploadBatch* batch = nullptr);
+		// streamed texture, only levels firstMip and below are uploaded.
+		// source is kept for later residency changes, uncompressed
+		// sources need their mip chain built.
+		LvTexture(
+			LvDevice& device,
+			std::shared_ptr<const Builder> source,
+			uint32_t firstMip,
+			LvUploadBatch* batch = nullptr);
 		~LvTexture();
 
 		LvTexture(const LvTexture&) = delete;
@@ -41,10 +127,42 @@ namespace lv
 
 		static std::unique_ptr<LvTexture> createTextureFromFile(
 			LvDevice& device,
-			const std::string& filepath);
+			const std::string& filepath,
+			LvUploadBatch* batch = nullptr);
+
+		// through the texture cache, compressed if the device samples BCn
+		// and plain RGBA8 otherwise
+		static void loadBuilder(
+			LvDevice& device,
+			const std::string& filepath,
+			Builder& builder);
 
 		VkImage getImage() const { return textureImage; }
+		VkFormat getFormat() const { return format; }
+		uint32_t getWidth() const { return static_cast<uint32_t>(width); }
+		uint32_t getHeight() const { return static_cast<uint32_t>(height); }
+		uint32_t getMipLevels() const { return mipLevels; }
 		VkDescriptorImageInfo descriptorInfo();
-		void* getMappedMemory() const { return textureImageMemory; }
+		uint32_t getBindlessIndex() const { return bindlessIndex; }
+		void* getMappedMemory() const { return textureImageAllocation.mapped; }
+
+		bool isStreamed() const { return streamSource != nullptr; }
+		uint32_t getResidentMip() const { return residentMip; }
+		// smallest first mip a streamed texture is ever reduced to
+		uint32_t getTailMip() const;
+		static uint32_t computeTailMip(
+			uint32_t width,
+			uint32_t height,
+			uint32_t levelCount);
+		// bytes of levels firstMip and below, without allocation padding
+		VkDeviceSize getLevelRangeSize(uint32_t firstMip) const;
+
+		// the texture keeps sampling its current image until the batch
+		// has completed and the residency is swapped in
+		Residency createResidency(uint32_t firstMip, LvUploadBatch& batch);
+		// returns the replaced image, which frames in flight may still
+		// sample, so destroying it is up to the caller
+		Residency swapResidency(Residency residency);
+		static void destroyResidency(LvDevice& device, Residency& residency);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,494 @@
+#include "lv_texture_cache.hpp"
+#include "lv_image_utils.hpp"
+#include "lv_utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lv
+{
+	static constexpr uint8_t KTX2_IDENTIFIER[12] = {
+		0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	static constexpr char SOURCE_KEY[] = "LvSource";
+
+	struct Ktx2Header
+	{
+		uint8_t identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct Ktx2LevelIndex
+	{
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+	static_assert(sizeof(Ktx2LevelIndex) == 24, "KTX2 level index layout");
+
+	// value of the "LvSource" key
+	struct SourceInfo
+	{
+		uint32_t version;
+		uint32_t format;
+		uint64_t sourceHash;
+	};
+
+	static std::atomic<uint64_t> sizeLimit{ LvTextureCache::DEFAULT_SIZE_LIMIT };
+	static std::mutex evictMutex;
+
+	static uint32_t alignUp(uint32_t value, uint32_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	static LvBlockEncoder::Format toBlockFormat(LvTextureCache::Format format)
+	{
+		switch (format)
+		{
+		case LvTextureCache::Format::BC1:
+			return LvBlockEncoder::Format::BC1;
+		case LvTextureCache::Format::BC3:
+			return LvBlockEncoder::Format::BC3;
+		case LvTextureCache::Format::BC7:
+		default:
+			return LvBlockEncoder::Format::BC7;
+		}
+	}
+
+	// KTX2 aligns levels to the least common multiple of the texel block
+	// size and 4
+	static uint32_t getLevelAlignment(LvTextureCache::Format format)
+	{
+		if (!LvTextureCache::isBlockCompressed(format))
+			return 4;
+		return LvBlockEncoder::getBlockSize(toBlockFormat(format));
+	}
+
+	// Khronos basic data format descriptor of a cache format
+	static std::vector<uint32_t> makeDataFormatDescriptor(LvTextureCache::Format format)
+	{
+		constexpr uint32_t MODEL_RGBSDA = 1;
+		constexpr uint32_t MODEL_BC1A = 128;
+		constexpr uint32_t MODEL_BC3 = 130;
+		constexpr uint32_t MODEL_BC7 = 134;
+		constexpr uint32_t CHANNEL_COLOR = 0;
+		constexpr uint32_t CHANNEL_GREEN = 1;
+		constexpr uint32_t CHANNEL_BLUE = 2;
+		constexpr uint32_t CHANNEL_ALPHA = 15;
+		constexpr uint32_t QUALIFIER_LINEAR = 1 << 4;
+		constexpr uint32_t PRIMARIES_BT709 = 1;
+		constexpr uint32_t TRANSFER_SRGB = 2;
+
+		struct Sample { uint32_t bitOffset; uint32_t bitLength; uint32_t channel; };
+		std::vector<Sample> samples;
+		uint32_t model = 0;
+		switch (format)
+		{
+		case LvTextureCache::Format::BC1:
+			model = MODEL_BC1A;
+			samples = { { 0, 64, CHANNEL_COLOR } };
+			break;
+		case LvTextureCache::Format::BC3:
+			model = MODEL_BC3;
+			samples = { { 0, 64, CHANNEL_ALPHA }, { 64, 64, CHANNEL_COLOR } };
+			break;
+		case LvTextureCache::Format::BC7:
+			model = MODEL_BC7;
+			samples = { { 0, 128, CHANNEL_COLOR } };
+			break;
+		case LvTextureCache::Format::RGBA8:
+			model = MODEL_RGBSDA;
+			samples = {
+				{ 0, 8, CHANNEL_COLOR },
+				{ 8, 8, CHANNEL_GREEN },
+				{ 16, 8, CHANNEL_BLUE },
+				{ 24, 8, CHANNEL_ALPHA | QUALIFIER_LINEAR } };
+			break;
+		}
+
+		const bool isBlock = LvTextureCache::isBlockCompressed(format);
+		const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+		std::vector<uint32_t> words;
+		words.push_back(4 + blockSize);
+		words.push_back(0); // vendor Khronos, descriptor type basic
+		words.push_back(2 | (blockSize << 16));
+		words.push_back(model | (PRIMARIES_BT709 << 8) | (TRANSFER_SRGB << 16));
+		// texel block dimensions minus one, 4x4 for BCn
+		words.push_back(isBlock ? (3 | (3 << 8)) : 0);
+		words.push_back(isBlock ? LvBlockEncoder::getBlockSize(toBlockFormat(format)) : 4);
+		words.push_back(0);
+		for (const auto& sample : samples)
+		{
+			words.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channel << 24));
+			words.push_back(0);
+			words.push_back(0);
+			words.push_back(isBlock ? UINT32_MAX : 255);
+		}
+		return words;
+	}
+
+	std::string LvTextureCache::getCachePath(uint64_t sourceHash, Format format)
+	{
+		static const char* formatNames[] = { "bc1", "bc3", "bc7", "rgba8" };
+		char hashName[17];
+		snprintf(hashName, sizeof(hashName), "%016llx",
+			static_cast<unsigned long long>(sourceHash));
+		return std::string(CACHE_DIRECTORY) + "/" + hashName + "."
+			+ formatNames[static_cast<uint32_t>(format)] + ".ktx2";
+	}
+
+	VkFormat LvTextureCache::getVkFormat(Format format)
+	{
+		switch (format)
+		{
+		case Format::BC1:
+			return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+		case Format::BC3:
+			return VK_FORMAT_BC3_SRGB_BLOCK;
+		case Format::RGBA8:
+			return VK_FORMAT_R8G8B8A8_SRGB;
+		case Format::BC7:
+		default:
+			return VK_FORMAT_BC7_SRGB_BLOCK;
+		}
+	}
+
+	bool LvTextureCache::isBlockCompressed(Format format)
+	{
+		return format != Format::RGBA8;
+	}
+
+	size_t LvTextureCache::getLevelSize(Format format, uint32_t width, uint32_t height)
+	{
+		if (!isBlockCompressed(format))
+			return size_t(width) * height * 4;
+		return LvBlockEncoder::getEncodedSize(toBlockFormat(format), width, height);
+	}
+
+	bool LvTextureCache::hashSource(const std::string& sourcePath, uint64_t& sourceHash)
+	{
+		LvMappedFile sourceFile;
+		if (!sourceFile.open(sourcePath))
+			return false;
+		sourceHash = hashBytes(sourceFile.data(), sourceFile.size());
+		return true;
+	}
+
+	static Ktx2Header readHeader(const LvMappedFile& cacheFile)
+	{
+		Ktx2Header header;
+		memcpy(&header, cacheFile.data(), sizeof(header));
+		return header;
+	}
+
+	static Ktx2LevelIndex readLevelIndex(const LvMappedFile& cacheFile, uint32_t level)
+	{
+		Ktx2LevelIndex index;
+		memcpy(
+			&index,
+			static_cast<const uint8_t*>(cacheFile.data()) + sizeof(Ktx2Header)
+				+ level * sizeof(Ktx2LevelIndex),
+			sizeof(index));
+		return index;
+	}
+
+	static bool findSourceInfo(
+		const LvMappedFile& cacheFile,
+		const Ktx2Header& header,
+		SourceInfo& info)
+	{
+		if (uint64_t(header.kvdByteOffset) + header.kvdByteLength > cacheFile.size())
+			return false;
+
+		const uint8_t* kvd = static_cast<const uint8_t*>(cacheFile.data()) + header.kvdByteOffset;
+		uint32_t offset = 0;
+		while (offset + 4 <= header.kvdByteLength)
+		{
+			uint32_t length;
+			memcpy(&length, kvd + offset, 4);
+			if (offset + 4 + length > header.kvdByteLength)
+				return false;
+
+			const uint8_t* entry = kvd + offset + 4;
+			if (length == sizeof(SOURCE_KEY) + sizeof(SourceInfo)
+				&& memcmp(entry, SOURCE_KEY, sizeof(SOURCE_KEY)) == 0)
+			{
+				memcpy(&info, entry + sizeof(SOURCE_KEY), sizeof(SourceInfo));
+				return true;
+			}
+			offset = alignUp(offset + 4 + length, 4);
+		}
+		return false;
+	}
+
+	bool LvTextureCache::load(
+		uint64_t sourceHash,
+		Format format,
+		LvMappedFile& cacheFile)
+	{
+		const std::string cachePath = getCachePath(sourceHash, format);
+		if (!cacheFile.open(cachePath))
+			return false;
+
+		bool valid = cacheFile.size() >= sizeof(Ktx2Header);
+		if (valid)
+		{
+			const Ktx2Header header = readHeader(cacheFile);
+			valid = memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0
+				&& header.vkFormat == static_cast<uint32_t>(getVkFormat(format))
+				&& header.supercompressionScheme == 0
+				&& header.levelCount >= 1
+				&& sizeof(Ktx2Header) + uint64_t(header.levelCount) * sizeof(Ktx2LevelIndex)
+					<= cacheFile.size();
+
+			for (uint32_t level = 0; valid && level < header.levelCount; level++)
+			{
+				const Ktx2LevelIndex index = readLevelIndex(cacheFile, level);
+				const uint32_t width = std::max(header.pixelWidth >> level, 1u);
+				const uint32_t height = std::max(header.pixelHeight >> level, 1u);
+				valid = index.byteLength == getLevelSize(format, width, height)
+					&& index.byteOffset + index.byteLength <= cacheFile.size();
+			}
+
+			SourceInfo cachedInfo{};
+			valid = valid
+				&& findSourceInfo(cacheFile, header, cachedInfo)
+				&& cachedInfo.version == VERSION
+				&& cachedInfo.format == static_cast<uint32_t>(format)
+				&& cachedInfo.sourceHash == sourceHash;
+		}
+
+		if (!valid)
+		{
+			cacheFile.close();
+			return false;
+		}
+
+		// the write time doubles as the last use for evict()
+		std::error_code ec;
+		std::filesystem::last_write_time(
+			cachePath, std::filesystem::file_time_type::clock::now(), ec);
+		return true;
+	}
+
+	bool LvTextureCache::store(
+		uint64_t sourceHash,
+		Format format,
+		const uint8_t* pixels,
+		uint32_t width,
+		uint32_t height)
+	{
+		SourceInfo sourceInfo{};
+		sourceInfo.version = VERSION;
+		sourceInfo.format = static_cast<uint32_t>(format);
+		sourceInfo.sourceHash = sourceHash;
+
+		const auto mipChain = LvImageUtils::buildMipChain(pixels, width, height, true);
+		const uint32_t levelCount = static_cast<uint32_t>(mipChain.levels.size()) + 1;
+
+		std::vector<std::vector<uint8_t>> levels(levelCount);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			const uint8_t* levelPixels = level == 0
+				? pixels
+				: mipChain.data.data() + mipChain.levels[level - 1].offset;
+			const uint32_t levelWidth = level == 0 ? width : mipChain.levels[level - 1].width;
+			const uint32_t levelHeight = level == 0 ? height : mipChain.levels[level - 1].height;
+
+			if (!isBlockCompressed(format))
+			{
+				levels[level].assign(
+					levelPixels,
+					levelPixels + getLevelSize(format, levelWidth, levelHeight));
+				continue;
+			}
+			levels[level].resize(getLevelSize(format, levelWidth, levelHeight));
+			LvBlockEncoder::encodeImage(
+				toBlockFormat(format),
+				levelPixels,
+				levelWidth,
+				levelHeight,
+				levels[level].data());
+		}
+
+		const std::vector<uint32_t> dfd = makeDataFormatDescriptor(format);
+
+		std::vector<uint8_t> kvd(4 + sizeof(SOURCE_KEY) + sizeof(SourceInfo));
+		const uint32_t kvdEntryLength = static_cast<uint32_t>(kvd.size() - 4);
+		memcpy(kvd.data(), &kvdEntryLength, 4);
+		memcpy(kvd.data() + 4, SOURCE_KEY, sizeof(SOURCE_KEY));
+		memcpy(kvd.data() + 4 + sizeof(SOURCE_KEY), &sourceInfo, sizeof(SourceInfo));
+		kvd.resize(alignUp(static_cast<uint32_t>(kvd.size()), 4));
+
+		Ktx2Header header{};
+		memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+		header.vkFormat = static_cast<uint32_t>(getVkFormat(format));
+		header.typeSize = 1;
+		header.pixelWidth = width;
+		header.pixelHeight = height;
+		header.faceCount = 1;
+		header.levelCount = levelCount;
+		header.dfdByteOffset = static_cast<uint32_t>(
+			sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex));
+		header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+		header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+		header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+		// KTX2 stores the smallest level first, each one aligned
+		const uint32_t alignment = getLevelAlignment(format);
+		std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+		uint64_t offset = alignUp(header.kvdByteOffset + header.kvdByteLength, alignment);
+		for (uint32_t level = levelCount; level-- > 0;)
+		{
+			levelIndex[level].byteOffset = offset;
+			levelIndex[level].byteLength = levels[level].size();
+			levelIndex[level].uncompressedByteLength = levels[level].size();
+			offset += levels[level].size();
+		}
+
+		// written to a temporary file first, like LvMeshCache::store.
+		// Workers may store the same contents at once, so every thread
+		// gets its own temporary file.
+		std::error_code ec;
+		std::filesystem::create_directories(CACHE_DIRECTORY, ec);
+		const std::string cachePath = getCachePath(sourceHash, format);
+		const std::string tempPath = cachePath + "."
+			+ std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()))
+			+ ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return false;
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(
+				reinterpret_cast<const char*>(levelIndex.data()),
+				levelIndex.size() * sizeof(Ktx2LevelIndex));
+			file.write(
+				reinterpret_cast<const char*>(dfd.data()),
+				dfd.size() * sizeof(uint32_t));
+			file.write(reinterpret_cast<const char*>(kvd.data()), kvd.size());
+
+			for (uint32_t level = levelCount; level-- > 0;)
+			{
+				const uint64_t position = static_cast<uint64_t>(file.tellp());
+				const std::vector<char> padding(levelIndex[level].byteOffset - position, 0);
+				file.write(padding.data(), padding.size());
+				file.write(
+					reinterpret_cast<const char*>(levels[level].data()),
+					levels[level].size());
+			}
+
+			if (!file.good())
+			{
+				file.close();
+				std::filesystem::remove(tempPath, ec);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(tempPath, cachePath, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tempPath, ec);
+			return false;
+		}
+
+		evict();
+		return true;
+	}
+
+	void LvTextureCache::setSizeLimit(uint64_t bytes)
+	{
+		sizeLimit = bytes;
+	}
+
+	void LvTextureCache::evict()
+	{
+		std::lock_guard<std::mutex> lock(evictMutex);
+
+		struct Entry
+		{
+			std::filesystem::path path;
+			uint64_t size;
+			std::filesystem::file_time_type lastUse;
+		};
+		std::vector<Entry> entries;
+		uint64_t totalSize = 0;
+
+		std::error_code ec;
+		for (const auto& file : std::filesystem::directory_iterator(CACHE_DIRECTORY, ec))
+		{
+			if (file.path().extension() != ".ktx2")
+				continue;
+
+			std::error_code fileEc;
+			Entry entry{ file.path(), file.file_size(fileEc), file.last_write_time(fileEc) };
+			if (fileEc)
+				continue;
+			totalSize += entry.size;
+			entries.push_back(std::move(entry));
+		}
+
+		const uint64_t limit = sizeLimit.load();
+		if (totalSize <= limit)
+			return;
+
+		std::sort(entries.begin(), entries.end(),
+			[](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+
+		// entries mapped right now stay readable on POSIX, on Windows
+		// their removal fails and they are retried on the next store
+		for (const auto& entry : entries)
+		{
+			if (totalSize <= limit)
+				break;
+			if (std::filesystem::remove(entry.path, ec))
+				totalSize -= entry.size;
+		}
+	}
+
+	uint32_t LvTextureCache::getLevelCount(const LvMappedFile& cacheFile)
+	{
+		return readHeader(cacheFile).levelCount;
+	}
+
+	LvTextureCache::Level LvTextureCache::getLevel(
+		const LvMappedFile& cacheFile,
+		uint32_t level)
+	{
+		const Ktx2Header header = readHeader(cacheFile);
+		const Ktx2LevelIndex index = readLevelIndex(cacheFile, level);
+
+		Level result{};
+		result.data = static_cast<const uint8_t*>(cacheFile.data()) + index.byteOffset;
+		result.size = static_cast<size_t>(index.byteLength);
+		result.width = std::max(header.pixelWidth >> level, 1u);
+		result.height = std::max(header.pixelHeight >> level, 1u);
+		return result;
+	}
+}
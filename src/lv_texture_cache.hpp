@@ -0,0 +1,75 @@
+#pragma once
+
+#include "lv_block_encoder.hpp"
+#include "lv_mapped_file.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+
+namespace lv
+{
+	// Decoded copy of a texture with its full mip chain, either block
+	// compressed or as plain RGBA8 texels, so warm starts skip image
+	// decoding and map the levels straight into the staging ring.
+	//
+	// Entries are keyed by a hash of the source contents and live in
+	// CACHE_DIRECTORY as "<hash>.<format>.ktx2", so an edited source
+	// simply misses and identical files share one entry. Each file is a
+	// plain KTX2 container (no supercompression) that external tools can
+	// inspect, the source hash is repeated in the "LvSource" key/value
+	// entry. Level data is laid out the way vkCmdCopyBufferToImage
+	// expects it. Once the directory grows past the size limit the least
+	// recently used entries are deleted.
+	class LvTextureCache
+	{
+	public:
+		static constexpr uint32_t VERSION = 2;
+		static constexpr const char* CACHE_DIRECTORY = "cache/textures";
+		static constexpr uint64_t DEFAULT_SIZE_LIMIT = 512ull << 20;
+
+		enum class Format : uint32_t
+		{
+			BC1,  // same values as LvBlockEncoder::Format
+			BC3,
+			BC7,
+			RGBA8 // uncompressed, for devices without BCn sampling
+		};
+
+		struct Level
+		{
+			const uint8_t* data;
+			size_t size;
+			uint32_t width;
+			uint32_t height;
+		};
+
+		static bool hashSource(const std::string& sourcePath, uint64_t& sourceHash);
+
+		// maps the entry of the source with that hash, fails if there is none
+		static bool load(
+			uint64_t sourceHash,
+			Format format,
+			LvMappedFile& cacheFile);
+		// encodes every mip level of the decoded source pixels
+		static bool store(
+			uint64_t sourceHash,
+			Format format,
+			const uint8_t* pixels,
+			uint32_t width,
+			uint32_t height);
+
+		static void setSizeLimit(uint64_t bytes);
+		// deletes least recently used entries until the directory fits
+		static void evict();
+
+		static std::string getCachePath(uint64_t sourceHash, Format format);
+		static VkFormat getVkFormat(Format format);
+		static bool isBlockCompressed(Format format);
+		static size_t getLevelSize(Format format, uint32_t width, uint32_t height);
+
+		static uint32_t getLevelCount(const LvMappedFile& cacheFile);
+		static Level getLevel(const LvMappedFile& cacheFile, uint32_t level);
+	};
+}
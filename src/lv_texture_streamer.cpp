@@ -0,0 +1,347 @@
+#include "lv_texture_streamer.hpp"
+#include "lv_swapchain.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace lv
+{
+	LvTextureStreamer::LvTextureStreamer(
+		LvDevice& device,
+		VkDeviceSize budgetBytes,
+		VkDeviceSize uploadBytesPerFrame)
+		: device{device},
+		budgetBytes{budgetBytes},
+		uploadBytesPerFrame{uploadBytesPerFrame}
+	{
+	}
+
+	LvTextureStreamer::~LvTextureStreamer()
+	{
+		for (auto& upload : pendingUploads)
+		{
+			upload.batch->wait();
+			for (auto& pending : upload.residencies)
+				LvTexture::destroyResidency(device, pending.residency);
+		}
+		for (auto& retired : retiredResidencies)
+			LvTexture::destroyResidency(device, retired.residency);
+	}
+
+	void LvTextureStreamer::update(
+		LvScene& scene,
+		const LvCamera& camera,
+		float viewportHeight)
+	{
+		++frameCount;
+		stats = {};
+		stats.budgetBytes = budgetBytes;
+
+		completeUploads();
+		releaseRetired();
+		updateDesiredMips(scene, camera, viewportHeight);
+		scheduleResidencies();
+	}
+
+	void LvTextureStreamer::completeUploads()
+	{
+		while (!pendingUploads.empty() && pendingUploads.front().batch->isComplete())
+		{
+			for (auto& pending : pendingUploads.front().residencies)
+			{
+				auto previous = pending.texture->swapResidency(pending.residency);
+				retiredResidencies.push_back({ previous, frameCount });
+				entries.at(pending.texture.get()).isPending = false;
+			}
+			pendingUploads.pop_front();
+		}
+	}
+
+	void LvTextureStreamer::releaseRetired()
+	{
+		// the frame recorded after this update waits on the fence of the
+		// frame MAX_FRAMES_IN_FLIGHT before it, so anything retired before
+		// that one is no longer sampled
+		while (!retiredResidencies.empty()
+			&& retiredResidencies.front().frame + LvSwapChain::MAX_FRAMES_IN_FLIGHT
+				< frameCount)
+		{
+			LvTexture::destroyResidency(device, retiredResidencies.front().residency);
+			retiredResidencies.pop_front();
+		}
+	}
+
+	void LvTextureStreamer::updateDesiredMips(
+		LvScene& scene,
+		const LvCamera& camera,
+		float viewportHeight)
+	{
+		for (auto it = entries.begin(); it != entries.end();)
+		{
+			auto texture = it->second.texture.lock();
+			if (texture == nullptr)
+			{
+				it = entries.erase(it);
+				continue;
+			}
+			it->second.desiredMip = texture->getTailMip();
+			++it;
+		}
+
+		const glm::mat4 view = camera.getView();
+		const glm::mat4 projection = camera.getProjection();
+		const float focalX = std::abs(projection[0][0]);
+		const float focalY = std::abs(projection[1][1]);
+		// distance of a point from a side plane of the frustum is
+		// (|x| - z * tanHalf) * cos, with cos = 1 / sqrt(1 + tanHalf^2)
+		const float tanHalfX = 1.f / focalX;
+		const float tanHalfY = 1.f / focalY;
+		const float secHalfX = std::sqrt(1.f + tanHalfX * tanHalfX);
+		const float secHalfY = std::sqrt(1.f + tanHalfY * tanHalfY);
+
+		auto& renderables = scene.getRenderables();
+		auto& transforms = scene.getTransforms();
+		for (size_t i = 0; i < renderables.size(); i++)
+		{
+			auto& object = renderables.getComponents()[i];
+			if (object.model == nullptr
+				|| object.texture == nullptr
+				|| !object.texture->isStreamed())
+				continue;
+
+			const auto& transform = transforms.get(renderables.getIds()[i]);
+			auto& texture = object.texture;
+			auto found = entries.find(texture.get());
+			if (found == entries.end())
+			{
+				Entry entry{};
+				entry.texture = texture;
+				entry.desiredMip = texture->getTailMip();
+				found = entries.emplace(texture.get(), entry).first;
+			}
+			Entry& entry = found->second;
+
+			// world scale, so scaled parents grow the bounds as well
+			const float scale = std::max(
+				glm::length(glm::vec3(transform.worldMatrix[0])),
+				std::max(
+					glm::length(glm::vec3(transform.worldMatrix[1])),
+					glm::length(glm::vec3(transform.worldMatrix[2]))));
+			const float radius = object.model->getBoundsRadius() * scale;
+			const glm::vec4 center = view * transform.worldMatrix
+				* glm::vec4(object.model->getBoundsCenter(), 1.f);
+
+			if (center.z + radius <= 0.f
+				|| (std::abs(center.x) - center.z * tanHalfX) > radius * secHalfX
+				|| (std::abs(center.y) - center.z * tanHalfY) > radius * secHalfY)
+				continue;
+
+			entry.lastVisibleFrame = frameCount;
+
+			// texels across the texture against the pixels the bounding
+			// sphere covers, full detail once the camera is inside it
+			uint32_t mip = 0;
+			if (center.z > radius)
+			{
+				const float pixels = radius * focalY * viewportHeight / center.z;
+				const float texels = static_cast<float>(
+					std::max(texture->getWidth(), texture->getHeight()));
+				if (pixels < texels)
+					mip = static_cast<uint32_t>(std::floor(std::log2(texels / pixels)));
+			}
+			entry.desiredMip = std::min(entry.desiredMip, mip);
+		}
+	}
+
+	void LvTextureStreamer::scheduleResidencies()
+	{
+		VkDeviceSize residentBytes = 0;
+		for (auto& kv : entries)
+		{
+			const Entry& entry = kv.second;
+			auto texture = entry.texture.lock();
+			const uint32_t currentMip = entry.isPending
+				? entry.targetMip : texture->getResidentMip();
+			const bool isVisible = entry.lastVisibleFrame == frameCount;
+
+			residentBytes += texture->getLevelRangeSize(currentMip);
+			stats.desiredBytes += texture->getLevelRangeSize(
+				isVisible ? entry.desiredMip : currentMip);
+			stats.textureCount += 1;
+			stats.visibleCount += isVisible ? 1 : 0;
+			stats.pendingCount += entry.isPending ? 1 : 0;
+		}
+
+		auto batch = std::make_unique<LvUploadBatch>(device);
+		std::vector<PendingResidency> residencies;
+
+		// the budget may have been lowered or the view changed since the
+		// last frame
+		while (residentBytes > budgetBytes
+			&& evictOne(residentBytes, residencies, *batch, true))
+		{
+		}
+
+		struct Candidate
+		{
+			Entry* entry;
+			std::shared_ptr<LvTexture> texture;
+		};
+		std::vector<Candidate> candidates;
+		for (auto& kv : entries)
+		{
+			Entry& entry = kv.second;
+			auto texture = entry.texture.lock();
+			if (entry.lastVisibleFrame == frameCount
+				&& !entry.isPending
+				&& entry.desiredMip < texture->getResidentMip())
+				candidates.push_back({ &entry, texture });
+		}
+		// the textures missing the most detail first
+		std::sort(candidates.begin(), candidates.end(),
+			[](const Candidate& a, const Candidate& b) {
+				return a.texture->getResidentMip() - a.entry->desiredMip
+					> b.texture->getResidentMip() - b.entry->desiredMip;
+			});
+
+		for (auto& candidate : candidates)
+		{
+			Entry& entry = *candidate.entry;
+			auto& texture = candidate.texture;
+
+			if (stats.uploadedBytes >= uploadBytesPerFrame)
+			{
+				stats.deferredCount += 1;
+				continue;
+			}
+
+			const uint32_t currentMip = texture->getResidentMip();
+			const VkDeviceSize currentBytes = texture->getLevelRangeSize(currentMip);
+			const auto bytesWith = [&](uint32_t mip) {
+				return residentBytes - currentBytes + texture->getLevelRangeSize(mip);
+			};
+
+			uint32_t targetMip = entry.desiredMip;
+			// never at the expense of other visible textures, they would
+			// keep trading levels every frame
+			while (bytesWith(targetMip) > budgetBytes
+				&& evictOne(residentBytes, residencies, *batch, false))
+			{
+			}
+			// whatever fits if nothing else could be evicted
+			while (targetMip < currentMip && bytesWith(targetMip) > budgetBytes)
+				++targetMip;
+
+			if (targetMip != entry.desiredMip)
+				stats.deferredCount += 1;
+			if (targetMip >= currentMip)
+				continue;
+
+			residencies.push_back({ texture, texture->createResidency(targetMip, *batch) });
+			entry.isPending = true;
+			entry.targetMip = targetMip;
+
+			residentBytes = bytesWith(targetMip);
+			stats.uploadCount += 1;
+			stats.uploadedBytes += texture->getLevelRangeSize(targetMip);
+		}
+
+		stats.residentBytes = residentBytes;
+		stats.pendingCount += static_cast<uint32_t>(residencies.size());
+
+		if (residencies.empty())
+			return;
+
+		batch->submit();
+		pendingUploads.push_back({ std::move(batch), std::move(residencies) });
+	}
+
+	bool LvTextureStreamer::evictOne(
+		VkDeviceSize& residentBytes,
+		std::vector<PendingResidency>& residencies,
+		LvUploadBatch& batch,
+		bool canReduceVisible)
+	{
+		// textures out of view go back to their tail in LRU order, then
+		// visible ones lose the detail they do not currently need and as
+		// a last resort one level they do need, largest first
+		struct Victim
+		{
+			Entry* entry = nullptr;
+			std::shared_ptr<LvTexture> texture;
+			uint32_t mip = 0;
+			uint32_t tier = 0;
+			VkDeviceSize size = 0;
+		};
+		Victim victim{};
+
+		for (auto& kv : entries)
+		{
+			Entry& entry = kv.second;
+			if (entry.isPending)
+				continue;
+
+			auto texture = entry.texture.lock();
+			const uint32_t currentMip = texture->getResidentMip();
+			const uint32_t tailMip = texture->getTailMip();
+			const bool isVisible = entry.lastVisibleFrame == frameCount;
+
+			Victim candidate{ &entry, texture, tailMip, 0, 0 };
+			if (isVisible && entry.desiredMip > currentMip)
+			{
+				candidate.mip = entry.desiredMip;
+				candidate.tier = 1;
+			}
+			else if (isVisible)
+			{
+				if (!canReduceVisible)
+					continue;
+				candidate.mip = std::min(currentMip + 1, tailMip);
+				candidate.tier = 2;
+			}
+			if (candidate.mip <= currentMip)
+				continue;
+			candidate.size = texture->getLevelRangeSize(currentMip);
+
+			const bool isBetter = victim.entry == nullptr
+				|| candidate.tier < victim.tier
+				|| (candidate.tier == victim.tier
+					&& (entry.lastVisibleFrame < victim.entry->lastVisibleFrame
+						|| (entry.lastVisibleFrame == victim.entry->lastVisibleFrame
+							&& candidate.size > victim.size)));
+			if (isBetter)
+				victim = candidate;
+		}
+
+		if (victim.entry == nullptr)
+			return false;
+
+		auto& texture = victim.texture;
+		residentBytes -= victim.size - texture->getLevelRangeSize(victim.mip);
+
+		// the coarser levels are uploaded again, they are a small
+		// fraction of what is freed
+		residencies.push_back({ texture, texture->createResidency(victim.mip, batch) });
+		victim.entry->isPending = true;
+		victim.entry->targetMip = victim.mip;
+
+		stats.evictionCount += 1;
+		stats.uploadedBytes += texture->getLevelRangeSize(victim.mip);
+		return true;
+	}
+
+	void LvTextureStreamer::printStats() const
+	{
+		const float MiB = 1024.f * 1024.f;
+		std::cout << "texture streaming: " << stats.textureCount << " textures ("
+			<< stats.visibleCount << " visible, "
+			<< stats.pendingCount << " pending), resident "
+			<< stats.residentBytes / MiB << " / " << stats.budgetBytes / MiB
+			<< " MiB, desired " << stats.desiredBytes / MiB << " MiB, "
+			<< stats.uploadCount << " uploads, "
+			<< stats.evictionCount << " evictions ("
+			<< stats.uploadedBytes / MiB << " MiB), "
+			<< stats.deferredCount << " deferred" << std::endl;
+	}
+}
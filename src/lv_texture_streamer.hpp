@@ -0,0 +1,132 @@
+#pragma once
+
+#include "lv_device.hpp"
+#include "lv_texture.hpp"
+#include "lv_scene.hpp"
+#include "lv_camera.hpp"
+#include "lv_upload_batch.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace lv
+{
+	// Keeps streamed textures (see LvAssetLoader::setTextureStreaming) at
+	// the mips their on-screen size calls for. Each frame the visible
+	// objects pick the first mip their texture needs, missing levels are
+	// uploaded in the background and swapped in once the upload is done.
+	// When the budget would be exceeded the least recently seen textures
+	// drop back to their mip tail first, visible ones are only reduced if
+	// they alone exceed it.
+	//
+	// Residency changes rebuild the texture's image at the new size, the
+	// replaced one is destroyed once no frame in flight can sample it.
+	// The budget counts level bytes, allocation padding is not included.
+	class LvTextureStreamer
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_UPLOAD_BYTES_PER_FRAME = 16ull << 20;
+
+		struct Stats
+		{
+			uint32_t textureCount = 0;
+			uint32_t visibleCount = 0;
+			// residency changes waiting on their upload
+			uint32_t pendingCount = 0;
+			// scheduled this frame
+			uint32_t uploadCount = 0;
+			uint32_t evictionCount = 0;
+			// wanted more detail but hit the budget or the upload limit
+			uint32_t deferredCount = 0;
+			VkDeviceSize residentBytes = 0;
+			// resident bytes if every visible texture had its desired mips
+			VkDeviceSize desiredBytes = 0;
+			VkDeviceSize uploadedBytes = 0;
+			VkDeviceSize budgetBytes = 0;
+		};
+
+	private:
+		struct Entry
+		{
+			std::weak_ptr<LvTexture> texture;
+			uint32_t desiredMip = 0;
+			uint64_t lastVisibleFrame = 0;
+			// first mip once the pending residency is swapped in
+			uint32_t targetMip = 0;
+			bool isPending = false;
+		};
+
+		struct PendingResidency
+		{
+			std::shared_ptr<LvTexture> texture;
+			LvTexture::Residency residency;
+		};
+
+		struct PendingUpload
+		{
+			std::unique_ptr<LvUploadBatch> batch;
+			std::vector<PendingResidency> residencies;
+		};
+
+		struct RetiredResidency
+		{
+			LvTexture::Residency residency;
+			uint64_t frame;
+		};
+
+		LvDevice& device;
+		VkDeviceSize budgetBytes;
+		VkDeviceSize uploadBytesPerFrame;
+
+		std::unordered_map<const LvTexture*, Entry> entries;
+		std::deque<PendingUpload> pendingUploads;
+		std::deque<RetiredResidency> retiredResidencies;
+		uint64_t frameCount = 0;
+
+		Stats stats{};
+
+	public:
+		LvTextureStreamer(
+			LvDevice& device,
+			VkDeviceSize budgetBytes,
+			VkDeviceSize uploadBytesPerFrame = DEFAULT_UPLOAD_BYTES_PER_FRAME);
+		~LvTextureStreamer();
+
+		LvTextureStreamer(const LvTextureStreamer&) = delete;
+		LvTextureStreamer& operator=(const LvTextureStreamer&) = delete;
+
+		// call once per frame before recording it, never blocks on the GPU.
+		// Assumes a perspective projection.
+		void update(
+			LvScene& scene,
+			const LvCamera& camera,
+			float viewportHeight);
+
+		void setBudget(VkDeviceSize bytes) { budgetBytes = bytes; }
+		VkDeviceSize getBudget() const { return budgetBytes; }
+
+		// of the last update
+		const Stats& getStats() const { return stats; }
+		void printStats() const;
+
+	private:
+		void completeUploads();
+		void releaseRetired();
+		void updateDesiredMips(
+			LvScene& scene,
+			const LvCamera& camera,
+			float viewportHeight);
+		void scheduleResidencies();
+		// picks the entry to drop to a coarser mip, false if none is left
+		bool evictOne(
+			VkDeviceSize& residentBytes,
+			std::vector<PendingResidency>& residencies,
+			LvUploadBatch& batch,
+			bool canReduceVisible);
+	};
+}
@@ -0,0 +1,136 @@
+#include "lv_texture_table.hpp"
+#include "lv_swapchain.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lv
+{
+	LvTextureTable::LvTextureTable(LvDevice& device)
+		: device{device}
+	{
+		VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+		indexingProperties.sType =
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties{};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &indexingProperties;
+		vkGetPhysicalDeviceProperties2(device.getPhysicalDevice(), &properties);
+
+		capacity = std::min({
+			MAX_TEXTURES,
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+
+		setLayout = LvDescriptorSetLayout::Builder(device)
+			.addBinding(
+				0,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				VK_SHADER_STAGE_FRAGMENT_BIT,
+				capacity,
+				VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+				| VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+				| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT)
+			.setLayoutFlags(
+				VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+			.build();
+
+		pool = LvDescriptorPool::Builder(device)
+			.setMaxSets(1)
+			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity)
+			.build();
+
+		if (!LvDescriptorWriter(*setLayout, *pool).build(descriptorSet))
+		{
+			throw std::runtime_error("failed to allocate texture table");
+		}
+	}
+
+	LvTextureTable::~LvTextureTable()
+	{
+		for (auto& retired : retiredSlots)
+			LvTexture::destroyResidency(device, retired.residency);
+	}
+
+	uint32_t LvTextureTable::add(const VkDescriptorImageInfo& imageInfo)
+	{
+		std::lock_guard<std::mutex> lock(tableMutex);
+
+		uint32_t index;
+		if (!freeIndices.empty())
+		{
+			index = freeIndices.back();
+			freeIndices.pop_back();
+		}
+		else if (nextIndex < capacity)
+		{
+			index = nextIndex++;
+		}
+		else
+		{
+			throw std::runtime_error("texture table is full");
+		}
+
+		// the slot is not used by any pending frame, so it can be
+		// written while the set is bound
+		VkDescriptorImageInfo info = imageInfo;
+		LvDescriptorWriter(*setLayout, *pool)
+			.writeImage(
+				0,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				&info,
+				index)
+			.overwrite(descriptorSet);
+
+		return index;
+	}
+
+	void LvTextureTable::remove(uint32_t index, const LvTexture::Residency& residency)
+	{
+		std::lock_guard<std::mutex> lock(tableMutex);
+
+		// the descriptor stays as is, the frames still in flight may
+		// sample it and partially bound slots are never read afterwards
+		retiredSlots.push_back({ index, frameCount, residency });
+	}
+
+	void LvTextureTable::bind(
+		VkCommandBuffer commandBuffer,
+		VkPipelineLayout pipelineLayout,
+		uint32_t setIndex)
+	{
+		{
+			std::lock_guard<std::mutex> lock(tableMutex);
+
+			// the frame being recorded waited on the fence of the frame
+			// MAX_FRAMES_IN_FLIGHT before it
+			++frameCount;
+			while (!retiredSlots.empty()
+				&& retiredSlots.front().frame + LvSwapChain::MAX_FRAMES_IN_FLIGHT
+					< frameCount)
+			{
+				LvTexture::destroyResidency(device, retiredSlots.front().residency);
+				freeIndices.push_back(retiredSlots.front().index);
+				retiredSlots.pop_front();
+			}
+		}
+
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipelineLayout,
+			setIndex,
+			1,
+			&descriptorSet,
+			0,
+			nullptr);
+	}
+
+	uint32_t LvTextureTable::getTextureCount()
+	{
+		std::lock_guard<std::mutex> lock(tableMutex);
+		return nextIndex
+			- static_cast<uint32_t>(freeIndices.size() + retiredSlots.size());
+	}
+}
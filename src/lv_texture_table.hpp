@@ -0,0 +1,75 @@
+#pragma once
+
+#include "lv_device.hpp"
+#include "lv_descriptor.hpp"
+#include "lv_texture.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lv
+{
+	// One descriptor set holding every live texture in a partially bound
+	// sampler array. It is bound once per frame and draws pick their
+	// texture with an index, so nothing is rewritten between draws.
+	// Slots are written with update after bind and only reused once the
+	// frames that could still sample them are finished. A removed
+	// texture's image is destroyed at the same point.
+	class LvTextureTable
+	{
+	public:
+		static constexpr uint32_t MAX_TEXTURES = 4096;
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	private:
+		struct RetiredSlot
+		{
+			uint32_t index;
+			uint64_t frame;
+			// destroyed when the slot is reused, empty if its owner
+			// keeps the image
+			LvTexture::Residency residency;
+		};
+
+		LvDevice& device;
+		uint32_t capacity;
+
+		std::unique_ptr<LvDescriptorSetLayout> setLayout;
+		std::unique_ptr<LvDescriptorPool> pool;
+		VkDescriptorSet descriptorSet;
+
+		uint32_t nextIndex = 0;
+		std::vector<uint32_t> freeIndices;
+		std::deque<RetiredSlot> retiredSlots;
+		uint64_t frameCount = 0;
+		std::mutex tableMutex;
+
+	public:
+		LvTextureTable(LvDevice& device);
+		~LvTextureTable();
+
+		LvTextureTable(const LvTextureTable&) = delete;
+		LvTextureTable& operator=(const LvTextureTable&) = delete;
+
+		// returns the slot the shaders index the texture with
+		uint32_t add(const VkDescriptorImageInfo& imageInfo);
+		// residency is the image behind the slot if it goes away with it
+		void remove(uint32_t index, const LvTexture::Residency& residency = {});
+
+		// call once per frame before any draw that samples the table
+		void bind(
+			VkCommandBuffer commandBuffer,
+			VkPipelineLayout pipelineLayout,
+			uint32_t setIndex);
+
+		VkDescriptorSetLayout getDescriptorSetLayout() const
+		{ return setLayout->getDescriptorSetLayout(); }
+		uint32_t getCapacity() const { return capacity; }
+		uint32_t getTextureCount();
+	};
+}
@@ -0,0 +1,127 @@
+#include "lv_thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace lv
+{
+	LvThreadPool::LvThreadPool(uint32_t threadCount)
+	{
+		workers.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			workers.emplace_back([this]() { workerLoop(); });
+		}
+	}
+
+	LvThreadPool::~LvThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(tasksMutex);
+			isStopping = true;
+		}
+		tasksCondition.notify_all();
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	uint32_t LvThreadPool::defaultThreadCount()
+	{
+		uint32_t count = std::thread::hardware_concurrency();
+		return count > 0 ? count : 1;
+	}
+
+	void LvThreadPool::enqueue(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(tasksMutex);
+			tasks.push_back(std::move(task));
+		}
+		tasksCondition.notify_one();
+	}
+
+	void LvThreadPool::workerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(tasksMutex);
+				tasksCondition.wait(lock, [this]() {
+					return isStopping || !tasks.empty();
+				});
+
+				if (tasks.empty())
+					return;
+
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	void LvThreadPool::parallelFor(
+		uint32_t count,
+		const std::function<void(uint32_t)>& task)
+	{
+		if (count == 0)
+			return;
+
+		struct ParallelForState
+		{
+			std::atomic<uint32_t> nextItem{ 0 };
+			std::atomic<uint32_t> finishedItems{ 0 };
+			std::mutex doneMutex;
+			std::condition_variable doneCondition;
+			std::exception_ptr error;
+		};
+		auto state = std::make_shared<ParallelForState>();
+
+		// every participant pulls items until none are left, so the
+		// call completes even if all workers are busy elsewhere
+		auto runItems = [state, count, &task]() {
+			uint32_t item;
+			while ((item = state->nextItem.fetch_add(1)) < count)
+			{
+				try
+				{
+					task(item);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(state->doneMutex);
+					if (!state->error)
+						state->error = std::current_exception();
+				}
+
+				if (state->finishedItems.fetch_add(1) + 1 == count)
+				{
+					std::lock_guard<std::mutex> lock(state->doneMutex);
+					state->doneCondition.notify_all();
+				}
+			}
+		};
+
+		const uint32_t helperCount =
+			std::min(getThreadCount(), count - 1);
+		for (uint32_t i = 0; i < helperCount; ++i)
+		{
+			enqueue(runItems);
+		}
+		runItems();
+
+		std::unique_lock<std::mutex> lock(state->doneMutex);
+		state->doneCondition.wait(lock, [&state, count]() {
+			return state->finishedItems.load() == count;
+		});
+
+		if (state->error)
+			std::rethrow_exception(state->error);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lv
+{
+	// Fixed size pool of worker threads for CPU side asset work
+	class LvThreadPool
+	{
+	private:
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> tasks;
+		std::mutex tasksMutex;
+		std::condition_variable tasksCondition;
+		bool isStopping{ false };
+
+	public:
+		explicit LvThreadPool(uint32_t threadCount);
+		~LvThreadPool();
+
+		LvThreadPool(const LvThreadPool&) = delete;
+		LvThreadPool& operator=(const LvThreadPool&) = delete;
+
+		void enqueue(std::function<void()> task);
+
+		// runs task(0) .. task(count - 1) on the workers and the calling
+		// thread, returns once every item has finished
+		void parallelFor(
+			uint32_t count,
+			const std::function<void(uint32_t)>& task);
+
+		uint32_t getThreadCount() const
+		{
+			return static_cast<uint32_t>(workers.size());
+		}
+
+		static uint32_t defaultThreadCount();
+
+	private:
+		void workerLoop();
+	};
+}
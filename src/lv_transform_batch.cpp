@@ -0,0 +1,326 @@
+#include "lv_transform_batch.hpp"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#define LV_TRANSFORM_BATCH_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LV_TRANSFORM_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace lv
+{
+	void LvTransformBatch::Arrays::resize(size_t count)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			translation[axis].resize(count);
+			rotation[axis].resize(count);
+			scale[axis].resize(count);
+		}
+	}
+
+	void LvTransformBatch::Arrays::set(
+		size_t index,
+		const glm::vec3& translationValue,
+		const glm::vec3& rotationValue,
+		const glm::vec3& scaleValue)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			translation[axis][index] = translationValue[axis];
+			rotation[axis][index] = rotationValue[axis];
+			scale[axis][index] = scaleValue[axis];
+		}
+	}
+
+	// same terms as TransformComponent::mat4(), see there for the order
+	static void computeRangeScalar(
+		const LvTransformBatch::Arrays& transforms,
+		size_t begin,
+		size_t end,
+		glm::mat4* worldMatrices,
+		glm::mat4* normalMatrices)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const float c3 = std::cos(transforms.rotation[2][i]);
+			const float s3 = std::sin(transforms.rotation[2][i]);
+			const float c2 = std::cos(transforms.rotation[0][i]);
+			const float s2 = std::sin(transforms.rotation[0][i]);
+			const float c1 = std::cos(transforms.rotation[1][i]);
+			const float s1 = std::sin(transforms.rotation[1][i]);
+
+			const glm::vec3 axisX{ c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1 };
+			const glm::vec3 axisY{ c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3 };
+			const glm::vec3 axisZ{ c2 * s1, -s2, c1 * c2 };
+
+			const glm::vec3 scale{
+				transforms.scale[0][i], transforms.scale[1][i], transforms.scale[2][i] };
+			const glm::vec3 inverseScale = 1.0f / scale;
+
+			worldMatrices[i] = glm::mat4{
+				glm::vec4(scale.x * axisX, 0.f),
+				glm::vec4(scale.y * axisY, 0.f),
+				glm::vec4(scale.z * axisZ, 0.f),
+				glm::vec4(
+					transforms.translation[0][i],
+					transforms.translation[1][i],
+					transforms.translation[2][i],
+					1.f) };
+			normalMatrices[i] = glm::mat4{
+				glm::vec4(inverseScale.x * axisX, 0.f),
+				glm::vec4(inverseScale.y * axisY, 0.f),
+				glm::vec4(inverseScale.z * axisZ, 0.f),
+				glm::vec4(0.f) };
+		}
+	}
+
+#if defined(LV_TRANSFORM_BATCH_AVX2) || defined(LV_TRANSFORM_BATCH_SSE2)
+	// Thin wrappers so the kernel below is written once for both widths
+#ifdef LV_TRANSFORM_BATCH_AVX2
+	using Floats = __m256;
+	using Ints = __m256i;
+	static constexpr size_t LANES = 8;
+
+	static inline Floats load(const float* p) { return _mm256_loadu_ps(p); }
+	static inline Floats splat(float v) { return _mm256_set1_ps(v); }
+	static inline Floats zero() { return _mm256_setzero_ps(); }
+	static inline Floats add(Floats a, Floats b) { return _mm256_add_ps(a, b); }
+	static inline Floats sub(Floats a, Floats b) { return _mm256_sub_ps(a, b); }
+	static inline Floats mul(Floats a, Floats b) { return _mm256_mul_ps(a, b); }
+	static inline Floats div(Floats a, Floats b) { return _mm256_div_ps(a, b); }
+	static inline Floats bitAnd(Floats a, Floats b) { return _mm256_and_ps(a, b); }
+	static inline Floats bitAndNot(Floats a, Floats b) { return _mm256_andnot_ps(a, b); }
+	static inline Floats bitOr(Floats a, Floats b) { return _mm256_or_ps(a, b); }
+	static inline Floats bitXor(Floats a, Floats b) { return _mm256_xor_ps(a, b); }
+	static inline Ints toInts(Floats a) { return _mm256_cvttps_epi32(a); }
+	static inline Floats toFloats(Ints a) { return _mm256_cvtepi32_ps(a); }
+	static inline Ints splatInt(int v) { return _mm256_set1_epi32(v); }
+	static inline Ints addInt(Ints a, Ints b) { return _mm256_add_epi32(a, b); }
+	static inline Ints subInt(Ints a, Ints b) { return _mm256_sub_epi32(a, b); }
+	static inline Ints andInt(Ints a, Ints b) { return _mm256_and_si256(a, b); }
+	static inline Ints andNotInt(Ints a, Ints b) { return _mm256_andnot_si256(a, b); }
+	static inline Ints equalInt(Ints a, Ints b) { return _mm256_cmpeq_epi32(a, b); }
+	static inline Ints shiftLeft29(Ints a) { return _mm256_slli_epi32(a, 29); }
+	static inline Floats asFloats(Ints a) { return _mm256_castsi256_ps(a); }
+#else
+	using Floats = __m128;
+	using Ints = __m128i;
+	static constexpr size_t LANES = 4;
+
+	static inline Floats load(const float* p) { return _mm_loadu_ps(p); }
+	static inline Floats splat(float v) { return _mm_set1_ps(v); }
+	static inline Floats zero() { return _mm_setzero_ps(); }
+	static inline Floats add(Floats a, Floats b) { return _mm_add_ps(a, b); }
+	static inline Floats sub(Floats a, Floats b) { return _mm_sub_ps(a, b); }
+	static inline Floats mul(Floats a, Floats b) { return _mm_mul_ps(a, b); }
+	static inline Floats div(Floats a, Floats b) { return _mm_div_ps(a, b); }
+	static inline Floats bitAnd(Floats a, Floats b) { return _mm_and_ps(a, b); }
+	static inline Floats bitAndNot(Floats a, Floats b) { return _mm_andnot_ps(a, b); }
+	static inline Floats bitOr(Floats a, Floats b) { return _mm_or_ps(a, b); }
+	static inline Floats bitXor(Floats a, Floats b) { return _mm_xor_ps(a, b); }
+	static inline Ints toInts(Floats a) { return _mm_cvttps_epi32(a); }
+	static inline Floats toFloats(Ints a) { return _mm_cvtepi32_ps(a); }
+	static inline Ints splatInt(int v) { return _mm_set1_epi32(v); }
+	static inline Ints addInt(Ints a, Ints b) { return _mm_add_epi32(a, b); }
+	static inline Ints subInt(Ints a, Ints b) { return _mm_sub_epi32(a, b); }
+	static inline Ints andInt(Ints a, Ints b) { return _mm_and_si128(a, b); }
+	static inline Ints andNotInt(Ints a, Ints b) { return _mm_andnot_si128(a, b); }
+	static inline Ints equalInt(Ints a, Ints b) { return _mm_cmpeq_epi32(a, b); }
+	static inline Ints shiftLeft29(Ints a) { return _mm_slli_epi32(a, 29); }
+	static inline Floats asFloats(Ints a) { return _mm_castsi128_ps(a); }
+#endif
+
+	// Cephes sinf/cosf: reduces x to [-pi/4, pi/4] around the nearest
+	// multiple of pi/2 and picks the sine or cosine polynomial per
+	// octant, both results share the reduction
+	static inline void sinCos(Floats x, Floats& sine, Floats& cosine)
+	{
+		const Floats signMask = asFloats(splatInt(static_cast<int>(0x80000000u)));
+
+		Floats sineSign = bitAnd(x, signMask);
+		x = bitAndNot(signMask, x);
+
+		Ints octant = toInts(mul(x, splat(1.27323954473516f))); // 4 / pi
+		octant = andInt(addInt(octant, splatInt(1)), splatInt(~1));
+		const Floats y = toFloats(octant);
+
+		sineSign = bitXor(sineSign, asFloats(shiftLeft29(andInt(octant, splatInt(4)))));
+		const Floats cosineSign = asFloats(shiftLeft29(
+			andNotInt(subInt(octant, splatInt(2)), splatInt(4))));
+		const Floats usesSinePolynomial = asFloats(
+			equalInt(andInt(octant, splatInt(2)), splatInt(0)));
+
+		// pi / 4 split in three parts for an exact reduction
+		x = add(x, mul(y, splat(-0.78515625f)));
+		x = add(x, mul(y, splat(-2.4187564849853515625e-4f)));
+		x = add(x, mul(y, splat(-3.77489497744594108e-8f)));
+		const Floats z = mul(x, x);
+
+		Floats cosinePolynomial = splat(2.443315711809948e-5f);
+		cosinePolynomial = add(mul(cosinePolynomial, z), splat(-1.388731625493765e-3f));
+		cosinePolynomial = add(mul(cosinePolynomial, z), splat(4.166664568298827e-2f));
+		cosinePolynomial = mul(mul(cosinePolynomial, z), z);
+		cosinePolynomial = sub(cosinePolynomial, mul(z, splat(0.5f)));
+		cosinePolynomial = add(cosinePolynomial, splat(1.f));
+
+		Floats sinePolynomial = splat(-1.9515295891e-4f);
+		sinePolynomial = add(mul(sinePolynomial, z), splat(8.3321608736e-3f));
+		sinePolynomial = add(mul(sinePolynomial, z), splat(-1.6666654611e-1f));
+		sinePolynomial = add(mul(mul(sinePolynomial, z), x), x);
+
+		sine = bitOr(
+			bitAnd(usesSinePolynomial, sinePolynomial),
+			bitAndNot(usesSinePolynomial, cosinePolynomial));
+		cosine = bitOr(
+			bitAnd(usesSinePolynomial, cosinePolynomial),
+			bitAndNot(usesSinePolynomial, sinePolynomial));
+		sine = bitXor(sine, sineSign);
+		cosine = bitXor(cosine, cosineSign);
+	}
+
+	// rows hold one matrix column element for LANES objects, written out
+	// as that column of each object's matrix
+	static inline void storeColumns(
+		Floats x,
+		Floats y,
+		Floats z,
+		Floats w,
+		glm::mat4* matrices,
+		int column)
+	{
+#ifdef LV_TRANSFORM_BATCH_AVX2
+		// transposes within each 128 bit half, objects 0-3 end up in the
+		// low halves and 4-7 in the high ones
+		const __m256 xy0 = _mm256_unpacklo_ps(x, y);
+		const __m256 xy1 = _mm256_unpackhi_ps(x, y);
+		const __m256 zw0 = _mm256_unpacklo_ps(z, w);
+		const __m256 zw1 = _mm256_unpackhi_ps(z, w);
+		const __m256 columns[4] = {
+			_mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0)),
+			_mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2)),
+			_mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0)),
+			_mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2)) };
+		for (int i = 0; i < 4; i++)
+		{
+			_mm_storeu_ps(&matrices[i][column][0], _mm256_castps256_ps128(columns[i]));
+			_mm_storeu_ps(&matrices[i + 4][column][0], _mm256_extractf128_ps(columns[i], 1));
+		}
+#else
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(&matrices[0][column][0], x);
+		_mm_storeu_ps(&matrices[1][column][0], y);
+		_mm_storeu_ps(&matrices[2][column][0], z);
+		_mm_storeu_ps(&matrices[3][column][0], w);
+#endif
+	}
+
+	static inline void storeAxis(
+		const Floats* axis,
+		Floats scale,
+		Floats inverseScale,
+		glm::mat4* worldMatrices,
+		glm::mat4* normalMatrices,
+		int column)
+	{
+		storeColumns(
+			mul(scale, axis[0]),
+			mul(scale, axis[1]),
+			mul(scale, axis[2]),
+			zero(),
+			worldMatrices,
+			column);
+		storeColumns(
+			mul(inverseScale, axis[0]),
+			mul(inverseScale, axis[1]),
+			mul(inverseScale, axis[2]),
+			zero(),
+			normalMatrices,
+			column);
+	}
+
+	// returns how many transforms were done, the rest is left to the
+	// scalar path
+	static size_t computeRangeVector(
+		const LvTransformBatch::Arrays& transforms,
+		glm::mat4* worldMatrices,
+		glm::mat4* normalMatrices)
+	{
+		const size_t count = transforms.size() / LANES * LANES;
+		const Floats one = splat(1.f);
+
+		for (size_t i = 0; i < count; i += LANES)
+		{
+			Floats s1, c1, s2, c2, s3, c3;
+			sinCos(load(&transforms.rotation[1][i]), s1, c1);
+			sinCos(load(&transforms.rotation[0][i]), s2, c2);
+			sinCos(load(&transforms.rotation[2][i]), s3, c3);
+
+			const Floats s2s3 = mul(s2, s3);
+			const Floats c3s2 = mul(c3, s2);
+			const Floats axisX[3] = {
+				add(mul(c1, c3), mul(s1, s2s3)),
+				mul(c2, s3),
+				sub(mul(c1, s2s3), mul(c3, s1)) };
+			const Floats axisY[3] = {
+				sub(mul(c3s2, s1), mul(c1, s3)),
+				mul(c2, c3),
+				add(mul(c1, c3s2), mul(s1, s3)) };
+			const Floats axisZ[3] = {
+				mul(c2, s1),
+				sub(zero(), s2),
+				mul(c1, c2) };
+
+			const Floats scaleX = load(&transforms.scale[0][i]);
+			const Floats scaleY = load(&transforms.scale[1][i]);
+			const Floats scaleZ = load(&transforms.scale[2][i]);
+			storeAxis(axisX, scaleX, div(one, scaleX), worldMatrices + i, normalMatrices + i, 0);
+			storeAxis(axisY, scaleY, div(one, scaleY), worldMatrices + i, normalMatrices + i, 1);
+			storeAxis(axisZ, scaleZ, div(one, scaleZ), worldMatrices + i, normalMatrices + i, 2);
+			storeColumns(
+				load(&transforms.translation[0][i]),
+				load(&transforms.translation[1][i]),
+				load(&transforms.translation[2][i]),
+				one,
+				worldMatrices + i,
+				3);
+			storeColumns(zero(), zero(), zero(), zero(), normalMatrices + i, 3);
+		}
+		return count;
+	}
+#endif
+
+	void LvTransformBatch::compute(
+		const Arrays& transforms,
+		glm::mat4* worldMatrices,
+		glm::mat4* normalMatrices)
+	{
+		size_t done = 0;
+#if defined(LV_TRANSFORM_BATCH_AVX2) || defined(LV_TRANSFORM_BATCH_SSE2)
+		done = computeRangeVector(transforms, worldMatrices, normalMatrices);
+#endif
+		computeRangeScalar(transforms, done, transforms.size(), worldMatrices, normalMatrices);
+	}
+
+	void LvTransformBatch::computeScalar(
+		const Arrays& transforms,
+		glm::mat4* worldMatrices,
+		glm::mat4* normalMatrices)
+	{
+		computeRangeScalar(transforms, 0, transforms.size(), worldMatrices, normalMatrices);
+	}
+
+	const char* LvTransformBatch::getInstructionSet()
+	{
+#if defined(LV_TRANSFORM_BATCH_AVX2)
+		return "AVX2";
+#elif defined(LV_TRANSFORM_BATCH_SSE2)
+		return "SSE2";
+#else
+		return "scalar";
+#endif
+	}
+}
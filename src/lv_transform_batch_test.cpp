@@ -0,0 +1,127 @@
+#include "lv_transform_batch.hpp"
+
+#ifdef LV_TRANSFORM_BATCH_SELF_TEST
+
+#include "lv_scene.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace lv
+{
+	static bool matchesMatrix(
+		const glm::mat4& actual,
+		const glm::mat4& expected,
+		float tolerance)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				const float difference = std::abs(actual[column][row] - expected[column][row]);
+				if (difference > tolerance * std::max(1.f, std::abs(expected[column][row])))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	// runs compute on the transforms and compares every entry against
+	// TransformComponent::mat4() and normalMat4()
+	static bool checkTransforms(
+		const char* name,
+		const std::vector<TransformComponent>& transforms,
+		float tolerance)
+	{
+		LvTransformBatch::Arrays arrays;
+		arrays.resize(transforms.size());
+		for (size_t i = 0; i < transforms.size(); i++)
+			arrays.set(i, transforms[i].translation, transforms[i].rotation, transforms[i].scale);
+
+		std::vector<glm::mat4> worldMatrices(transforms.size());
+		std::vector<glm::mat4> normalMatrices(transforms.size());
+		LvTransformBatch::compute(arrays, worldMatrices.data(), normalMatrices.data());
+
+		size_t failures = 0;
+		for (size_t i = 0; i < transforms.size(); i++)
+		{
+			const bool worldMatches = matchesMatrix(
+				worldMatrices[i], transforms[i].mat4(), tolerance);
+			const bool normalMatches = matchesMatrix(
+				normalMatrices[i], transforms[i].normalMat4(), tolerance);
+			if (worldMatches && normalMatches)
+				continue;
+
+			if (failures++ < 4)
+			{
+				const glm::vec3& rotation = transforms[i].rotation;
+				std::cerr << "transform batch self test " << name << ": entry " << i
+					<< " of " << transforms.size() << " differs, rotation ("
+					<< rotation.x << ", " << rotation.y << ", " << rotation.z << ")"
+					<< (worldMatches ? "" : " world")
+					<< (normalMatches ? "" : " normal") << std::endl;
+			}
+		}
+		return failures == 0;
+	}
+
+	bool LvTransformBatch::runSelfTest()
+	{
+		constexpr float HALF_PI = 1.57079632679489661923f;
+		// wider than any register so every count below also has a tail
+		constexpr size_t LANES = 8;
+
+		std::mt19937 random{ 1234 };
+		std::uniform_real_distribution<float> angle{ -100.f, 100.f };
+		std::uniform_real_distribution<float> translation{ -50.f, 50.f };
+		std::uniform_real_distribution<float> scale{ 0.1f, 10.f };
+		std::uniform_int_distribution<int> quarterTurns{ -16, 16 };
+
+		auto randomTransform = [&](const glm::vec3& rotation)
+		{
+			TransformComponent transform{};
+			transform.translation = { translation(random), translation(random), translation(random) };
+			transform.rotation = rotation;
+			transform.scale = { scale(random), scale(random), scale(random) };
+			return transform;
+		};
+
+		bool passed = true;
+
+		// every count up to a few registers, so each tail length is covered
+		for (size_t count = 1; count <= 3 * LANES + 1; count++)
+		{
+			std::vector<TransformComponent> transforms;
+			for (size_t i = 0; i < count; i++)
+				transforms.push_back(randomTransform({ angle(random), angle(random), angle(random) }));
+			passed &= checkTransforms("random angles", transforms, 1e-5f);
+		}
+
+		// exact quarter turns, where sine and cosine must land on 0 and 1
+		std::vector<TransformComponent> quarterTransforms;
+		for (size_t i = 0; i < 16 * LANES + 3; i++)
+		{
+			quarterTransforms.push_back(randomTransform({
+				HALF_PI * quarterTurns(random),
+				HALF_PI * quarterTurns(random),
+				HALF_PI * quarterTurns(random) }));
+		}
+		passed &= checkTransforms("multiples of pi/2", quarterTransforms, 1e-5f);
+
+		std::vector<TransformComponent> largeTransforms;
+		for (size_t i = 0; i < 4 * LANES + 5; i++)
+		{
+			const float large = 1000.f + angle(random);
+			largeTransforms.push_back(randomTransform({ large, -large, angle(random) }));
+		}
+		passed &= checkTransforms("large angles", largeTransforms, 1e-4f);
+
+		std::cout << "transform batch self test (" << getInstructionSet() << "): "
+			<< (passed ? "passed" : "FAILED") << std::endl;
+		return passed;
+	}
+}
+
+#endif
@@ -0,0 +1,537 @@
+#include "lv_upload_batch.hpp"
+#include "lv_staging_ring.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace lv
+{
+	LvUploadBatch::LvUploadBatch(LvDevice& device)
+		: device{device}
+	{
+	}
+
+	LvUploadBatch::~LvUploadBatch()
+	{
+		// recorded work is never dropped. A failed submit or wait can't
+		// be thrown from here, callers that need to handle it call wait()
+		// themselves
+		if (commandBuffer != VK_NULL_HANDLE)
+		{
+			try
+			{
+				wait();
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "upload batch: " << e.what() << std::endl;
+			}
+		}
+		else if (hasSegment && !isSubmitted)
+			device.getStagingRing().discardSegment(segmentId);
+	}
+
+	VkCommandBuffer LvUploadBatch::getCommandBuffer()
+	{
+		beginCommandBuffer();
+		commandCount += 1;
+		return commandBuffer;
+	}
+
+	void LvUploadBatch::beginCommandBuffer()
+	{
+		assert(!isSubmitted && "batch was already submitted");
+
+		if (commandBuffer == VK_NULL_HANDLE)
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = device.getTransferCommandPool();
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(
+				device.getLogicalDevice(),
+				&allocInfo,
+				&commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate upload command buffer");
+			}
+
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+			vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		}
+	}
+
+	uint64_t LvUploadBatch::getSegment()
+	{
+		if (!hasSegment)
+		{
+			segmentId = device.getStagingRing().openSegment();
+			hasSegment = true;
+		}
+		return segmentId;
+	}
+
+	void LvUploadBatch::destroySubmission()
+	{
+		VkDevice vkDevice = device.getLogicalDevice();
+
+		if (commandBuffer != VK_NULL_HANDLE)
+		{
+			vkFreeCommandBuffers(vkDevice, device.getTransferCommandPool(), 1, &commandBuffer);
+			commandBuffer = VK_NULL_HANDLE;
+		}
+		if (acquireCommandBuffer != VK_NULL_HANDLE)
+		{
+			vkFreeCommandBuffers(vkDevice, device.getCommandPool(), 1, &acquireCommandBuffer);
+			acquireCommandBuffer = VK_NULL_HANDLE;
+		}
+		if (transferSemaphore != VK_NULL_HANDLE)
+		{
+			vkDestroySemaphore(vkDevice, transferSemaphore, nullptr);
+			transferSemaphore = VK_NULL_HANDLE;
+		}
+	}
+
+	void LvUploadBatch::copyBuffer(
+		VkBuffer srcBuffer,
+		VkBuffer dstBuffer,
+		VkDeviceSize size,
+		VkDeviceSize srcOffset,
+		VkDeviceSize dstOffset)
+	{
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset = srcOffset;
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = size;
+		vkCmdCopyBuffer(getCommandBuffer(), srcBuffer, dstBuffer, 1, &copyRegion);
+
+		hasBufferCopies = true;
+	}
+
+	void LvUploadBatch::copyBufferToImage(
+		VkBuffer buffer,
+		VkImage image,
+		uint32_t width,
+		uint32_t height,
+		VkDeviceSize bufferOffset,
+		uint32_t mipLevel)
+	{
+		VkBufferImageCopy region{};
+		region.bufferOffset = bufferOffset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = mipLevel;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = {
+			width,
+			height,
+			1
+		};
+
+		vkCmdCopyBufferToImage(
+			getCommandBuffer(),
+			buffer,
+			image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1,
+			&region
+		);
+	}
+
+	void LvUploadBatch::transitionImageLayout(
+		VkImage image,
+		VkImageLayout oldLayout,
+		VkImageLayout newLayout,
+		uint32_t mipLevels)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = mipLevels;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+
+		if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+			vkCmdPipelineBarrier(
+				getCommandBuffer(),
+				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				1, &barrier
+			);
+		}
+		else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+			// the transfer queue cannot name fragment shader stages, this
+			// ends up in the release / acquire pair on submit
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			getCommandBuffer();
+			imageBarriers.push_back(barrier);
+		}
+		else {
+			throw std::runtime_error("unsupported layout transition");
+		}
+	}
+
+	LvUploadBatch::Staging LvUploadBatch::stage(const void* data, VkDeviceSize size)
+	{
+		// the copies from here on cannot fail
+		beginCommandBuffer();
+
+		auto allocation = device.getStagingRing().allocate(getSegment(), size);
+		memcpy(allocation.mapped, data, size);
+		stagedBytes += size;
+
+		return { allocation.buffer, allocation.offset };
+	}
+
+	void LvUploadBatch::uploadToBuffer(
+		const void* data,
+		VkDeviceSize size,
+		VkBuffer dstBuffer,
+		VkDeviceSize dstOffset)
+	{
+		const Staging staging = stage(data, size);
+		copyBuffer(staging.buffer, dstBuffer, size, staging.offset, dstOffset);
+	}
+
+	void LvUploadBatch::uploadToImage(
+		const void* data,
+		VkDeviceSize size,
+		VkImage image,
+		uint32_t width,
+		uint32_t height,
+		uint32_t mipLevel)
+	{
+		const Staging staging = stage(data, size);
+		copyBufferToImage(staging.buffer, image, width, height, staging.offset, mipLevel);
+	}
+
+	void LvUploadBatch::generateMipmaps(
+		VkImage image,
+		uint32_t width,
+		uint32_t height,
+		uint32_t mipLevels)
+	{
+		getCommandBuffer();
+		mipmapJobs.push_back({ image, width, height, mipLevels });
+	}
+
+	void LvUploadBatch::recordMipmaps(VkCommandBuffer commandBuffer)
+	{
+		for (const auto& job : mipmapJobs)
+		{
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = job.image;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = 1;
+
+			int32_t mipWidth = static_cast<int32_t>(job.width);
+			int32_t mipHeight = static_cast<int32_t>(job.height);
+
+			for (uint32_t i = 1; i < job.mipLevels; i++)
+			{
+				barrier.subresourceRange.baseMipLevel = i - 1;
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+				vkCmdPipelineBarrier(
+					commandBuffer,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+					0,
+					0, nullptr,
+					0, nullptr,
+					1, &barrier
+				);
+
+				const int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+				const int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+
+				VkImageBlit blit{};
+				blit.srcOffsets[0] = { 0, 0, 0 };
+				blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+				blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.srcSubresource.mipLevel = i - 1;
+				blit.srcSubresource.baseArrayLayer = 0;
+				blit.srcSubresource.layerCount = 1;
+				blit.dstOffsets[0] = { 0, 0, 0 };
+				blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+				blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.dstSubresource.mipLevel = i;
+				blit.dstSubresource.baseArrayLayer = 0;
+				blit.dstSubresource.layerCount = 1;
+
+				vkCmdBlitImage(
+					commandBuffer,
+					job.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					job.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					1, &blit,
+					VK_FILTER_LINEAR);
+
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+				vkCmdPipelineBarrier(
+					commandBuffer,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+					0,
+					0, nullptr,
+					0, nullptr,
+					1, &barrier
+				);
+
+				mipWidth = nextWidth;
+				mipHeight = nextHeight;
+			}
+
+			// the last level was only ever written
+			barrier.subresourceRange.baseMipLevel = job.mipLevels - 1;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				1, &barrier
+			);
+		}
+	}
+
+	void LvUploadBatch::recordPendingBarriers(
+		VkCommandBuffer commandBuffer,
+		BarrierPass pass)
+	{
+		if (pass == BarrierPass::SameQueue)
+		{
+			if (!hasBufferCopies && imageBarriers.empty())
+				return;
+
+			// one global barrier covers every buffer copy
+			VkMemoryBarrier memoryBarrier{};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+			VkPipelineStageFlags dstStage = 0;
+			if (hasBufferCopies)
+				dstStage |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+			if (!imageBarriers.empty())
+				dstStage |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage,
+				0,
+				hasBufferCopies ? 1 : 0, &memoryBarrier,
+				0, nullptr,
+				static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data()
+			);
+			return;
+		}
+
+		if (imageBarriers.empty() && mipmapJobs.empty())
+			return;
+
+		// both halves of an ownership transfer carry the same queue
+		// families and layouts, each only names its own side's access
+		std::vector<VkImageMemoryBarrier> passBarriers = imageBarriers;
+		for (const auto& job : mipmapJobs)
+		{
+			// stays in TRANSFER_DST for the blits on the graphics queue
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.image = job.image;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = job.mipLevels;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = 1;
+			passBarriers.push_back(barrier);
+		}
+		for (auto& barrier : passBarriers)
+		{
+			barrier.srcQueueFamilyIndex = device.getTransferQueueFamily();
+			barrier.dstQueueFamilyIndex = device.getGraphicsQueueFamily();
+			if (pass == BarrierPass::Release)
+				barrier.dstAccessMask = 0;
+			else
+				barrier.srcAccessMask = 0;
+		}
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			pass == BarrierPass::Release
+				? VK_PIPELINE_STAGE_TRANSFER_BIT
+				: VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			pass == BarrierPass::Release
+				? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT
+				: VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			static_cast<uint32_t>(passBarriers.size()), passBarriers.data()
+		);
+	}
+
+	void LvUploadBatch::submit()
+	{
+		assert(!isSubmitted && "batch was already submitted");
+		isSubmitted = true;
+
+		if (commandBuffer == VK_NULL_HANDLE)
+		{
+			if (hasSegment)
+				device.getStagingRing().discardSegment(segmentId);
+			isDone = true;
+			return;
+		}
+
+		VkDevice vkDevice = device.getLogicalDevice();
+		const bool isDedicated = device.hasDedicatedTransferQueue();
+
+		if (!isDedicated)
+			recordMipmaps(commandBuffer);
+		recordPendingBarriers(
+			commandBuffer,
+			isDedicated ? BarrierPass::Release : BarrierPass::SameQueue);
+		vkEndCommandBuffer(commandBuffer);
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+
+		if (isDedicated)
+		{
+			VkSemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			if (vkCreateSemaphore(vkDevice, &semaphoreInfo, nullptr, &transferSemaphore) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create upload semaphore");
+			}
+
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &transferSemaphore;
+
+			if (vkQueueSubmit(
+				device.getTransferQueue(),
+				1,
+				&submitInfo,
+				VK_NULL_HANDLE) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to submit upload batch");
+			}
+
+			// the graphics side only waits on the semaphore, frames
+			// submitted meanwhile are not held back
+			static const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			submitInfo = VkSubmitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.waitSemaphoreCount = 1;
+			submitInfo.pWaitSemaphores = &transferSemaphore;
+			submitInfo.pWaitDstStageMask = &waitStage;
+
+			if (!imageBarriers.empty() || !mipmapJobs.empty())
+			{
+				VkCommandBufferAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				allocInfo.commandPool = device.getCommandPool();
+				allocInfo.commandBufferCount = 1;
+
+				if (vkAllocateCommandBuffers(vkDevice, &allocInfo, &acquireCommandBuffer) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to allocate upload command buffer");
+				}
+
+				VkCommandBufferBeginInfo beginInfo{};
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+				vkBeginCommandBuffer(acquireCommandBuffer, &beginInfo);
+				recordPendingBarriers(acquireCommandBuffer, BarrierPass::Acquire);
+				recordMipmaps(acquireCommandBuffer);
+				vkEndCommandBuffer(acquireCommandBuffer);
+
+				submitInfo.commandBufferCount = 1;
+				submitInfo.pCommandBuffers = &acquireCommandBuffer;
+			}
+		}
+
+		// the ring segment completes with the graphics side, which
+		// implies the transfer has finished
+		auto submission = device.getStagingRing().closeSegment(getSegment());
+
+		if (vkQueueSubmit(
+			device.getGraphicsQueue(),
+			1,
+			&submitInfo,
+			submission.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit upload batch");
+		}
+	}
+
+	bool LvUploadBatch::isComplete()
+	{
+		if (!isDone && isSubmitted && device.getStagingRing().isComplete(segmentId))
+		{
+			isDone = true;
+			destroySubmission();
+		}
+		return isDone;
+	}
+
+	void LvUploadBatch::wait()
+	{
+		if (!isSubmitted)
+			submit();
+		if (isDone)
+			return;
+
+		device.getStagingRing().wait(segmentId);
+		isDone = true;
+		destroySubmission();
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "lv_device.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace lv
+{
+	// Records buffer / image copies and layout transitions into a single
+	// command buffer that is submitted once. Data is staged through the
+	// device's staging ring at record time, so sources may be released
+	// right after a call. Destination resources have to outlive the batch.
+	// Only staging throws, nothing recorded after it can fail. An upload
+	// that stages all of its data before recording anything is either
+	// recorded whole or not at all.
+	//
+	// With a dedicated transfer queue the copies run there. Ownership of
+	// the written images is released to the graphics queue on submit and
+	// acquired by a small graphics submission that waits on the transfer,
+	// which also records the mip blits since those need a graphics queue.
+	// Upload destination buffers are shared by both families (see
+	// LvDevice::createBuffer), the semaphore alone orders them.
+	class LvUploadBatch
+	{
+	public:
+		struct Staging
+		{
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+		};
+
+	private:
+		LvDevice& device;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+		VkSemaphore transferSemaphore = VK_NULL_HANDLE;
+
+		bool isSubmitted = false;
+		bool isDone = false;
+		// staging ring segment, opened on the first upload or on submit
+		bool hasSegment = false;
+		uint64_t segmentId = 0;
+
+		// applied at submit, the queue family indices are filled in when
+		// ownership has to move to the graphics queue
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		bool hasBufferCopies = false;
+
+		struct MipmapJob
+		{
+			VkImage image;
+			uint32_t width;
+			uint32_t height;
+			uint32_t mipLevels;
+		};
+		std::vector<MipmapJob> mipmapJobs;
+
+		uint32_t commandCount = 0;
+		VkDeviceSize stagedBytes = 0;
+
+	public:
+		LvUploadBatch(LvDevice& device);
+		~LvUploadBatch();
+
+		LvUploadBatch(const LvUploadBatch&) = delete;
+		LvUploadBatch& operator=(const LvUploadBatch&) = delete;
+
+		void copyBuffer(
+			VkBuffer srcBuffer,
+			VkBuffer dstBuffer,
+			VkDeviceSize size,
+			VkDeviceSize srcOffset = 0,
+			VkDeviceSize dstOffset = 0);
+		void copyBufferToImage(
+			VkBuffer buffer,
+			VkImage image,
+			uint32_t width,
+			uint32_t height,
+			VkDeviceSize bufferOffset = 0,
+			uint32_t mipLevel = 0);
+		// transitions to SHADER_READ_ONLY_OPTIMAL are deferred to submit
+		void transitionImageLayout(
+			VkImage image,
+			VkImageLayout oldLayout,
+			VkImageLayout newLayout,
+			uint32_t mipLevels = 1);
+		// blits level 0 down the chain on submit. Every level has to be in
+		// TRANSFER_DST_OPTIMAL, all of them end up SHADER_READ_ONLY_OPTIMAL.
+		// The format must pass LvDevice::isLinearBlitSupported.
+		void generateMipmaps(
+			VkImage image,
+			uint32_t width,
+			uint32_t height,
+			uint32_t mipLevels);
+
+		// copies data into this batch's staging space without recording
+		// anything, the copies from it are recorded separately
+		Staging stage(const void* data, VkDeviceSize size);
+		void uploadToBuffer(
+			const void* data,
+			VkDeviceSize size,
+			VkBuffer dstBuffer,
+			VkDeviceSize dstOffset = 0);
+		void uploadToImage(
+			const void* data,
+			VkDeviceSize size,
+			VkImage image,
+			uint32_t width,
+			uint32_t height,
+			uint32_t mipLevel = 0);
+
+		// nothing may be recorded after submit
+		void submit();
+		bool isComplete();
+		// submits first if that has not happened yet, the destructor
+		// waits as well but only logs a failure
+		void wait();
+
+		uint32_t getCommandCount() const { return commandCount; }
+		VkDeviceSize getStagedBytes() const { return stagedBytes; }
+
+	private:
+		enum class BarrierPass
+		{
+			SameQueue, // transfer and graphics share a queue
+			Release,   // on the transfer queue
+			Acquire    // on the graphics queue
+		};
+
+		VkCommandBuffer getCommandBuffer();
+		void beginCommandBuffer();
+		uint64_t getSegment();
+		void recordPendingBarriers(
+			VkCommandBuffer commandBuffer,
+			BarrierPass pass);
+		void recordMipmaps(VkCommandBuffer commandBuffer);
+		void destroySubmission();
+	};
+}
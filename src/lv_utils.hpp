@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 
 namespace lv {
@@ -11,4 +13,20 @@ namespace lv {
         seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
         (hashCombine(seed, rest), ...);
     }
-}
\ No newline at end of file
+
+    // 64 bit FNV-1a, used to fingerprint source files for on-disk caches
+    inline uint64_t hashBytes(
+        const void* data,
+        size_t size,
+        uint64_t seed = 0xcbf29ce484222325ull)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+}
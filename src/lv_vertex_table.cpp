@@ -0,0 +1,104 @@
+#include "lv_vertex_table.hpp"
+
+#include <cstring>
+
+namespace lv
+{
+	static uint32_t nextPowerOfTwo(size_t value)
+	{
+		uint32_t result = 16;
+		while (result < value && result < (1u << 31))
+			result <<= 1;
+		return result;
+	}
+
+	// +0.f and -0.f compare equal, so they have to hash the same
+	static uint32_t floatBits(float value)
+	{
+		value += 0.f;
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	LvVertexTable::LvVertexTable(
+		std::vector<LvModel::Vertex>& vertices,
+		size_t expectedCount)
+		: vertices{vertices}
+	{
+		// keep the load factor at or below 3/4 for expectedCount entries
+		const uint32_t capacity = nextPowerOfTwo(
+			expectedCount + expectedCount / 3 + 1);
+		slots.assign(capacity, Slot{ 0, EMPTY_SLOT });
+		mask = capacity - 1;
+	}
+
+	uint32_t LvVertexTable::hashVertex(const LvModel::Vertex& vertex)
+	{
+		const float components[] = {
+			vertex.position.x, vertex.position.y, vertex.position.z,
+			vertex.color.x, vertex.color.y, vertex.color.z,
+			vertex.normal.x, vertex.normal.y, vertex.normal.z,
+			vertex.uv.x, vertex.uv.y
+		};
+
+		uint32_t hash = 0x811c9dc5u;
+		for (float component : components)
+		{
+			hash ^= floatBits(component);
+			hash *= 0x9e3779b1u;
+			hash ^= hash >> 15;
+		}
+		hash ^= hash >> 13;
+		hash *= 0x85ebca6bu;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+	uint32_t LvVertexTable::insert(const LvModel::Vertex& vertex)
+	{
+		// the table is sized up front, growing only covers callers
+		// that underestimated expectedCount
+		if ((vertices.size() + 1) * 4 > slots.size() * 3)
+			grow();
+
+		const uint32_t hash = hashVertex(vertex);
+		uint32_t slotIndex = hash & mask;
+
+		// linear probing, the cached hash skips most vertex compares
+		while (true)
+		{
+			Slot& slot = slots[slotIndex];
+			if (slot.index == EMPTY_SLOT)
+			{
+				slot.hash = hash;
+				slot.index = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(vertex);
+				return slot.index;
+			}
+			if (slot.hash == hash && vertices[slot.index] == vertex)
+			{
+				return slot.index;
+			}
+			slotIndex = (slotIndex + 1) & mask;
+		}
+	}
+
+	void LvVertexTable::grow()
+	{
+		std::vector<Slot> oldSlots = std::move(slots);
+		const uint32_t capacity = static_cast<uint32_t>(oldSlots.size()) * 2;
+		slots.assign(capacity, Slot{ 0, EMPTY_SLOT });
+		mask = capacity - 1;
+
+		for (const Slot& oldSlot : oldSlots)
+		{
+			if (oldSlot.index == EMPTY_SLOT) continue;
+
+			uint32_t slotIndex = oldSlot.hash & mask;
+			while (slots[slotIndex].index != EMPTY_SLOT)
+				slotIndex = (slotIndex + 1) & mask;
+			slots[slotIndex] = oldSlot;
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "lv_model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace lv
+{
+	// Flat open-addressing table used to deduplicate vertices while a
+	// mesh is assembled. Slots only hold a hash and an index into the
+	// vertex array, so lookups never allocate and each vertex is hashed
+	// once.
+	class LvVertexTable
+	{
+	private:
+		static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+		struct Slot
+		{
+			uint32_t hash;
+			uint32_t index;
+		};
+
+		std::vector<LvModel::Vertex>& vertices;
+		std::vector<Slot> slots;
+		uint32_t mask;
+
+	public:
+		// expectedCount is an upper bound of the unique vertices, the
+		// index count of the mesh works
+		LvVertexTable(
+			std::vector<LvModel::Vertex>& vertices,
+			size_t expectedCount);
+
+		LvVertexTable(const LvVertexTable&) = delete;
+		LvVertexTable& operator=(const LvVertexTable&) = delete;
+
+		// returns the index of vertex, appending it to the vertex array
+		// the first time it is seen
+		uint32_t insert(const LvModel::Vertex& vertex);
+
+		static uint32_t hashVertex(const LvModel::Vertex& vertex);
+
+	private:
+		void grow();
+	};
+}
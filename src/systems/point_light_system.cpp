@@ -64,6 +64,8 @@ namespace lv
 	{
 		PipelineConfigInfo pipelineConfig{};
 		LvPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		pipelineConfig.bindingDescriptions.clear();
+		pipelineConfig.attributeDescriptions.clear();
 
 		pipelineConfig.renderPass = renderPass;
 		pipelineConfig.pipelineLayout = pipelineLayout;
@@ -81,24 +83,26 @@ namespace lv
 			glm::mat4(1.f), 
 			0.5f * frameData.frameTime, // angle
 			{ 0.f, -1.f, 0.f });        // axis
+		auto& pointLights = frameData.scene.getPointLights();
 		int lightIndex = 0;
-		for (auto& kv : frameData.gameObjects)
+		for (size_t i = 0; i < pointLights.size(); i++)
 		{
-			auto& gameObject = kv.second;
-			if (gameObject.pointLight == nullptr) continue;
+			const auto& pointLight = pointLights.getComponents()[i];
+			auto& transform = frameData.scene.editTransform(pointLights.getIds()[i]);
 
 			assert(lightIndex < MAX_POINT_LIGHTS &&
 				"point lights exceede limits");
 
 			//animation
-			gameObject.transform.translation = glm::vec3(
+			transform.translation = glm::vec3(
 					rotateLight * 
-					glm::vec4(gameObject.transform.translation, 1.f));
+					glm::vec4(transform.translation, 1.f));
 
-			ubo.pointLights[lightIndex].position = 
-				glm::vec4(gameObject.transform.translation, 1.f);
+			// world position from the last LvScene::updateTransforms, the
+			// animation above shows from the next frame on, same as render
+			ubo.pointLights[lightIndex].position = transform.worldMatrix[3];
 			ubo.pointLights[lightIndex].color = glm::vec4(
-				gameObject.color, gameObject.pointLight->lightIntensity);
+				pointLight.color, pointLight.lightIntensity);
 
 			lightIndex += 1;
 		}
@@ -120,17 +124,19 @@ namespace lv
 			0,
 			nullptr);
 
-		for (auto& kv : frameData.gameObjects)
+		auto& pointLights = frameData.scene.getPointLights();
+		auto& transforms = frameData.scene.getTransforms();
+		for (size_t i = 0; i < pointLights.size(); i++)
 		{
-			auto& gameObject = kv.second;
-			if (gameObject.pointLight == nullptr) continue;
+			const auto& pointLight = pointLights.getComponents()[i];
+			const auto& transform = transforms.get(pointLights.getIds()[i]);
 
 			PointLightPushConstants push{};
-			push.position = glm::vec4(gameObject.transform.translation, 1.f);
+			push.position = transform.worldMatrix[3];
 			push.color = glm::vec4(
-				gameObject.color, 
-				gameObject.pointLight->lightIntensity);
-			push.radius = gameObject.transform.scale.x;
+				pointLight.color, 
+				pointLight.lightIntensity);
+			push.radius = pointLight.radius;
 
 			vkCmdPushConstants(
 				frameData.commandBuffer,
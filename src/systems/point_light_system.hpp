@@ -3,7 +3,7 @@
 #include "lv_device.hpp"
 #include "lv_pipeline.hpp"
 #include "lv_swapchain.hpp"
-#include "lv_game_object.hpp"
+#include "lv_scene.hpp"
 #include "lv_camera.hpp"
 #include "lv_frame_data.hpp"
 
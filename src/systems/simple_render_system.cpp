@@ -1,48 +1,58 @@
 #include "simple_render_system.hpp"
-#include "lv_descriptor.hpp"
+#include "lv_texture_table.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <tuple>
 
 namespace lv
 {
+	std::vector<VkVertexInputBindingDescription> SimpleInstanceData::getBindingDescriptions()
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		bindingDescriptions[0].binding = 1;
+		bindingDescriptions[0].stride = sizeof(SimpleInstanceData);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> SimpleInstanceData::getAttributeDescriptions()
+	{
+		// a mat4 takes one location per column, after the vertex's 0 - 3
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+		for (uint32_t column = 0; column < 4; column++)
+		{
+			attributeDescriptions.push_back({
+				4 + column,
+				1,
+				VK_FORMAT_R32G32B32A32_SFLOAT,
+				static_cast<uint32_t>(offsetof(SimpleInstanceData, modelMatrix) + column * sizeof(glm::vec4)) });
+		}
+		for (uint32_t column = 0; column < 4; column++)
+		{
+			attributeDescriptions.push_back({
+				8 + column,
+				1,
+				VK_FORMAT_R32G32B32A32_SFLOAT,
+				static_cast<uint32_t>(offsetof(SimpleInstanceData, normalMatrix) + column * sizeof(glm::vec4)) });
+		}
+		return attributeDescriptions;
+	}
+
 	SimpleRenderSystem::SimpleRenderSystem(
 		LvDevice& device, 
 		VkRenderPass renderPass,
 		VkDescriptorSetLayout globalSetLayout)
-		: lvDevice{ device }
+		: lvDevice{ device }, renderPass{ renderPass }
 	{
-		localDescriptorPool = LvDescriptorPool::Builder(device)
-			.setMaxSets(LvSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.addPoolSize(
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				LvSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.build();
-
-		localDescriptorSetLayout = LvDescriptorSetLayout::Builder(device)
-			.addBinding(
-				0,
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				VK_SHADER_STAGE_FRAGMENT_BIT)
-			.build();
-
-		localDescriptorSets.resize(LvSwapChain::MAX_FRAMES_IN_FLIGHT);
-		for (int i = 0; i < localDescriptorSets.size(); ++i)
-		{
-			// TODO check status of build function
-			LvDescriptorWriter(
-				*localDescriptorSetLayout, 
-				*localDescriptorPool
-			).build(localDescriptorSets[i]);
-		}
-
 		createPipelineLayout(globalSetLayout);
-		createPipeline(renderPass);
+		getPipeline(LvModel::VertexFormat::Standard);
 	}
 
 	SimpleRenderSystem::~SimpleRenderSystem()
@@ -54,18 +64,9 @@ namespace lv
 	void SimpleRenderSystem::createPipelineLayout(
 		VkDescriptorSetLayout globalSetLayout)
 	{
-		assert(localDescriptorSetLayout != VK_NULL_HANDLE 
-			&& "local descriptor set layout is not present");
-
-		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags =
-			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(SimplePushConstantsData);
-
 		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
 			globalSetLayout,
-			localDescriptorSetLayout->getDescriptorSetLayout()
+			lvDevice.getTextureTable().getDescriptorSetLayout()
 		};
 
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
@@ -74,8 +75,8 @@ namespace lv
 		pipelineLayoutInfo.setLayoutCount = 
 			static_cast<uint32_t>(descriptorSetLayouts.size());
 		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		pipelineLayoutInfo.pushConstantRangeCount = 0;
+		pipelineLayoutInfo.pPushConstantRanges = nullptr;
 		if (vkCreatePipelineLayout(
 			lvDevice.getLogicalDevice(),
 			&pipelineLayoutInfo,
@@ -84,26 +85,45 @@ namespace lv
 		}
 	}
 
-	void SimpleRenderSystem::createPipeline(VkRenderPass renderPass)
+	LvPipeline& SimpleRenderSystem::getPipeline(
+		LvModel::VertexFormat vertexFormat)
 	{
+		auto& pipeline = pipelines[static_cast<size_t>(vertexFormat)];
+		if (pipeline != nullptr)
+			return *pipeline;
+
 		PipelineConfigInfo pipelineConfig{};
 		LvPipeline::defaultPipelineConfigInfo(pipelineConfig);
 
 		pipelineConfig.renderPass = renderPass;
 		pipelineConfig.pipelineLayout = pipelineLayout;
 
-		lvPipeline = std::make_unique<LvPipeline>(
+		std::string vertShaderFilepath = "shaders/base_vert_shader.vert.spv";
+		if (vertexFormat == LvModel::VertexFormat::Packed)
+		{
+			pipelineConfig.bindingDescriptions =
+				LvModel::PackedVertex::getBindingDescriptions();
+			pipelineConfig.attributeDescriptions =
+				LvModel::PackedVertex::getAttributeDescriptions();
+			vertShaderFilepath = "shaders/base_vert_shader_packed.vert.spv";
+		}
+
+		for (const auto& binding : SimpleInstanceData::getBindingDescriptions())
+			pipelineConfig.bindingDescriptions.push_back(binding);
+		for (const auto& attribute : SimpleInstanceData::getAttributeDescriptions())
+			pipelineConfig.attributeDescriptions.push_back(attribute);
+
+		pipeline = std::make_unique<LvPipeline>(
 			lvDevice,
-			"shaders/base_vert_shader.vert.spv",
+			vertShaderFilepath,
 			"shaders/base_frag_shader.frag.spv",
 			pipelineConfig);
+		return *pipeline;
 	}
 
 	void SimpleRenderSystem::renderGameObjects(
 		FrameData& frameData)
 	{
-		lvPipeline->bind(frameData.commandBuffer);
-
 		vkCmdBindDescriptorSets(
 			frameData.commandBuffer, 
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -113,48 +133,136 @@ namespace lv
 			&frameData.globalDescriptorSet,
 			0,
 			nullptr);
+		lvDevice.getTextureTable().bind(
+			frameData.commandBuffer, pipelineLayout, 1);
+
+		auto& renderables = frameData.scene.getRenderables();
+		auto& transforms = frameData.scene.getTransforms();
 
-		for (auto& kv : frameData.gameObjects)
+		drawItems.clear();
+		drawCount = 0;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(renderables.size()); i++)
 		{
-			auto& object = kv.second;
+			const auto& object = renderables.getComponents()[i];
+			// models still loading
 			if (object.model == nullptr) continue;
-			SimplePushConstantsData push{};
-			push.modelMatrix = object.transform.mat4();
-			push.normalMatrix = object.transform.normalMat4();
 
-			vkCmdPushConstants(
-				frameData.commandBuffer,
-				pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-				0,
-				sizeof(SimplePushConstantsData),
-				&push);
+			drawItems.push_back({
+				object.model->getVertexFormat(),
+				object.model->getVertexBuffer(),
+				object.model.get(),
+				object.texture != nullptr
+					? static_cast<float>(object.texture->getBindlessIndex())
+					: -1.f,
+				i });
+		}
+		if (drawItems.empty())
+			return;
+
+		// instances of one model and texture end up next to each other,
+		// models sharing a pipeline or arena buffers as well
+		const auto sortKey = [](const DrawItem& item) {
+			return std::make_tuple(
+				item.vertexFormat,
+				item.vertexBuffer,
+				item.model,
+				item.textureIndex);
+		};
+		const auto isBefore = [&](const DrawItem& a, const DrawItem& b) {
+			return sortKey(a) < sortKey(b);
+		};
+		// the pool order rarely changes between frames
+		if (!std::is_sorted(drawItems.begin(), drawItems.end(), isBefore))
+			std::sort(drawItems.begin(), drawItems.end(), isBefore);
+
+		auto& instanceBuffer = getInstanceBuffer(
+			frameData.frameIndex, static_cast<uint32_t>(drawItems.size()));
+		auto* instances = static_cast<SimpleInstanceData*>(instanceBuffer.getMappedMemory());
+		for (size_t i = 0; i < drawItems.size(); i++)
+		{
+			const auto& item = drawItems[i];
+			const auto& transform = transforms.get(
+				renderables.getIds()[item.renderableIndex]);
+
+			instances[i].modelMatrix = transform.worldMatrix
+				* item.model->getPositionTransform();
+			instances[i].normalMatrix = transform.normalMatrix;
+			instances[i].normalMatrix[3][3] = item.textureIndex;
+		}
+		instanceBuffer.flush();
+
+		VkBuffer instanceBuffers[] = { instanceBuffer.getBuffer() };
+		VkDeviceSize instanceOffsets[] = { 0 };
+		vkCmdBindVertexBuffers(
+			frameData.commandBuffer, 1, 1, instanceBuffers, instanceOffsets);
+
+		// models share the geometry arena buffers, so buffers are only
+		// rebound when a model lives in a different block
+		LvPipeline* boundPipeline = nullptr;
+		VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+		VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+		for (size_t first = 0, end = 0; first < drawItems.size(); first = end)
+		{
+			auto& model = *drawItems[first].model;
+			const float textureIndex = drawItems[first].textureIndex;
+			end = first + 1;
+			while (end < drawItems.size()
+				&& drawItems[end].model == &model
+				&& drawItems[end].textureIndex == textureIndex)
+				++end;
+
+			LvPipeline& pipeline = getPipeline(model.getVertexFormat());
+			if (&pipeline != boundPipeline)
+			{
+				pipeline.bind(frameData.commandBuffer);
+				boundPipeline = &pipeline;
+			}
 
-			if (object.texture != nullptr)
+			if (model.getVertexBuffer() != boundVertexBuffer)
+			{
+				VkBuffer buffers[] = { model.getVertexBuffer() };
+				VkDeviceSize offsets[] = { 0 };
+				vkCmdBindVertexBuffers(
+					frameData.commandBuffer, 0, 1, buffers, offsets);
+				boundVertexBuffer = model.getVertexBuffer();
+			}
+			if (model.hasIndices() && model.getIndexBuffer() != boundIndexBuffer)
 			{
-				auto imageInfo = object.texture->descriptorInfo();
-				LvDescriptorWriter(
-					*localDescriptorSetLayout,
-					*localDescriptorPool)
-					.writeImage(
-						0, 
-						VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 
-						&imageInfo)
-					.overwrite(localDescriptorSets[frameData.frameIndex]);
-
-				vkCmdBindDescriptorSets(
+				vkCmdBindIndexBuffer(
 					frameData.commandBuffer,
-					VK_PIPELINE_BIND_POINT_GRAPHICS,
-					pipelineLayout,
-					1,
-					1,
-					&localDescriptorSets[frameData.frameIndex],
+					model.getIndexBuffer(),
 					0,
-					nullptr);
+					model.getIndexType());
+				boundIndexBuffer = model.getIndexBuffer();
 			}
+			model.draw(
+				frameData.commandBuffer,
+				static_cast<uint32_t>(end - first),
+				static_cast<uint32_t>(first));
+			drawCount += 1;
+		}
+	}
 
-			object.model->bind(frameData.commandBuffer);
-			object.model->draw(frameData.commandBuffer);
+	LvBuffer& SimpleRenderSystem::getInstanceBuffer(
+		int frameIndex,
+		uint32_t instanceCount)
+	{
+		// the frame's fence has been waited on, so nothing still reads
+		// the buffer this frame replaces
+		auto& buffer = instanceBuffers[frameIndex];
+		if (buffer == nullptr || buffer->getInstanceCount() < instanceCount)
+		{
+			const uint32_t capacity = std::max(
+				instanceCount,
+				buffer != nullptr ? buffer->getInstanceCount() * 2 : 256u);
+			buffer = std::make_unique<LvBuffer>(
+				lvDevice,
+				sizeof(SimpleInstanceData),
+				capacity,
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+			buffer->map();
 		}
+		return *buffer;
 	}
 }
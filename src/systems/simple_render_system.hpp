@@ -3,36 +3,62 @@
 #include "lv_device.hpp"
 #include "lv_pipeline.hpp"
 #include "lv_swapchain.hpp"
-#include "lv_game_object.hpp"
+#include "lv_scene.hpp"
 #include "lv_camera.hpp"
 #include "lv_frame_data.hpp"
-#include "lv_descriptor.hpp"
+#include "lv_buffer.hpp"
 
 #include <vulkan/vulkan.h>
 
+#include <array>
 #include <memory>
 #include <vector>
 
 namespace lv
 {
-	struct SimplePushConstantsData
+	// per instance vertex input, binding 1 next to the model's vertices
+	struct SimpleInstanceData
 	{
 		glm::mat4 modelMatrix{ 1.f };
+		// normalMatrix[3][3] carries the texture table index, negative
+		// for untextured objects
 		glm::mat4 normalMatrix{ 1.f };
+
+		static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+		static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 	};
 
+	// Draws every renderable of the scene with one instanced draw per
+	// model and texture. The instances' matrices are written to a per
+	// frame instance buffer in draw order each frame.
 	class SimpleRenderSystem
 	{
 	private:
+		struct DrawItem
+		{
+			// copied from the model so sorting does not chase pointers
+			LvModel::VertexFormat vertexFormat;
+			VkBuffer vertexBuffer;
+			LvModel* model;
+			float textureIndex;
+			// into the scene's render components
+			uint32_t renderableIndex;
+		};
+
 		LvDevice& lvDevice;
 		VkPipelineLayout pipelineLayout;
-		std::unique_ptr<LvPipeline> lvPipeline;
+		VkRenderPass renderPass;
+
+		// one pipeline per LvModel::VertexFormat, created on first use
+		std::array<std::unique_ptr<LvPipeline>, LvModel::VERTEX_FORMAT_COUNT>
+			pipelines;
 
-		std::unique_ptr<LvDescriptorPool> localDescriptorPool
-			= nullptr;
-		std::unique_ptr<LvDescriptorSetLayout> localDescriptorSetLayout
-			= nullptr;
-		std::vector<VkDescriptorSet> localDescriptorSets;
+		// host visible, grown on demand
+		std::array<std::unique_ptr<LvBuffer>, LvSwapChain::MAX_FRAMES_IN_FLIGHT>
+			instanceBuffers;
+		std::vector<DrawItem> drawItems;
+
+		uint32_t drawCount = 0;
 
 	public:
 		SimpleRenderSystem(
@@ -42,9 +68,13 @@ namespace lv
 		~SimpleRenderSystem();
 		void renderGameObjects(FrameData& frameData);
 
+		// of the last renderGameObjects
+		uint32_t getDrawCount() const { return drawCount; }
+		uint32_t getInstanceCount() const { return static_cast<uint32_t>(drawItems.size()); }
+
 	private:
-		void createPipeline(
-			VkRenderPass renderPass);
+		LvPipeline& getPipeline(LvModel::VertexFormat vertexFormat);
+		LvBuffer& getInstanceBuffer(int frameIndex, uint32_t instanceCount);
 		void createPipelineLayout(
 			VkDescriptorSetLayout globalSetLayout);
 	};